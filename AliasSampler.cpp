@@ -0,0 +1,64 @@
+#include "AliasSampler.h"
+
+using namespace std;
+
+AliasSampler::AliasSampler(const vector<double> &probabilities) : fN(probabilities.size()), fProbability(fN, 1.0), fAlias(fN) {
+    double sum = 0;
+    for (int i = 0; i < fN; i++)
+        sum += probabilities[i];
+    if (!(sum > 0)) {
+        fN = 0;
+        return;
+    }
+
+    // Probabilities scaled to an average of 1, split in columns below and above average
+    vector<double> scaled(fN);
+    vector<int> small, large;
+    for (int i = 0; i < fN; i++) {
+        fAlias[i] = i;
+        scaled[i] = probabilities[i] * fN / sum;
+        if (scaled[i] < 1)
+            small.push_back(i);
+        else
+            large.push_back(i);
+    }
+
+    // Fill each small column up to 1 with a part of a large one, which becomes its alias
+    while (!small.empty() && !large.empty()) {
+        const int s = small.back(), l = large.back();
+        small.pop_back();
+        fProbability[s] = scaled[s];
+        fAlias[s] = l;
+        scaled[l] -= 1 - scaled[s];
+        if (scaled[l] < 1) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // Columns left are full up to rounding errors
+    for (int i : small)
+        fProbability[i] = 1;
+    for (int i : large)
+        fProbability[i] = 1;
+}
+
+bool AliasSampler::IsValid() const {
+    return fN > 0;
+}
+
+int AliasSampler::GetN() const {
+    return fN;
+}
+
+// Indices for n uniform random numbers, in a loop the compiler vectorizes with gathers
+void AliasSampler::Sample(int n, const double *u, int *out) const {
+    const double *probability = fProbability.data();
+    const int *alias = fAlias.data();
+    for (int i = 0; i < n; i++) {
+        const double x = u[i] * fN;
+        int column = (int) x;
+        column = column < fN ? column : fN - 1;
+        out[i] = x - column < probability[column] ? column : alias[column];
+    }
+}
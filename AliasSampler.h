@@ -0,0 +1,35 @@
+#include <vector>
+
+#ifndef ALIAS_SAMPLER_H
+#define ALIAS_SAMPLER_H
+
+using namespace std;
+
+// Walker alias table: samples an index from any discrete distribution in constant time
+// with one uniform random number and no data-dependent branches. The table is built
+// once (Vose's method) from the probabilities, which need not be normalized but must have
+// a positive sum: otherwise the table is empty, IsValid is false and it must not be sampled
+class AliasSampler {
+    public:
+        AliasSampler(const vector<double> &probabilities);
+        bool IsValid() const;
+        int GetN() const;
+        int Sample(double u) const;
+        void Sample(int n, const double *u, int *out) const;
+
+    private:
+        int fN;
+        vector<double> fProbability;    // Probability of keeping the column, else its alias
+        vector<int> fAlias;
+};
+
+// Index for a uniform random number u in [0, 1): column floor(u * n), kept or replaced by
+// its alias depending on the fractional part
+inline int AliasSampler::Sample(double u) const {
+    const double x = u * fN;
+    int column = (int) x;
+    column = column < fN ? column : fN - 1;
+    return x - column < fProbability[column] ? column : fAlias[column];
+}
+
+#endif
@@ -1,4 +1,11 @@
+#include "AnalyzeData.h"
+
+#include "Config.h"
+#include "GenerateParticles.h"
 #include "Parameters.h"
+#include "Particle.h"
+#include "ParticleType.h"
+#include "Profiler.h"
 
 #include <TFile.h>
 #include <TH1D.h>
@@ -12,38 +19,167 @@
 #include <TCanvas.h>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
 
 using namespace std;
 
-void AnalyzeData() {
-    gROOT->SetBatch();
+// Fit a Breit-Wigner peak, starting from the given mass and width, and return the fit
+// function: parameter 1 is the mass and parameter 2 the width
+TF1 *FitBreitWigner(TH1D *h, double mass, double width) {
+    const string name = string(h->GetName()) + "Fit";
+    TF1 *fit = new TF1(name.c_str(), "[0] * TMath::BreitWigner(x, [1], [2])", h->GetXaxis()->GetXmin(), h->GetXaxis()->GetXmax());
+    fit->SetParNames("Constant", "Mass", "Width");
+    fit->SetParameters(h->Integral("width"), mass, width);
+    h->Fit(fit, "Q");
+    return fit;
+}
 
-    // Open root file and retrieve histograms
-    TFile *file = new TFile("histograms.root", "READ");
+// Fit a Gaussian peak, the model of the K* signal in the invariant mass differences, and
+// return the fit function: parameter 1 is the mean and parameter 2 the sigma
+TF1 *FitGaussianPeak(TH1 *h) {
+    h->Fit("gaus", "Q");
+    return h->GetFunction("gaus");
+}
 
+// Fit the K* peak of the run saved in fileName and check the consistency of its histograms:
+// all generation histograms have one entry per primary, the species fractions agree with
+// their probabilities and the fitted K* mass with that of the catalog, within ERROR_FACTOR
+// standard deviations. The particle catalog must be loaded with the parameters of the run
+bool SummarizeRun(const string fileName, RunSummary &summary) {
+    TFile *file = new TFile(fileName.c_str(), "READ");
     TH1D *particleTypesH = (TH1D*) file->Get("particleTypesH");
-    TH1D *azimutAngleH = (TH1D*) file->Get("azimutAngleH");
-    TH1D *polarAngleH = (TH1D*) file->Get("polarAngleH");
-    TH1D *momentumH = (TH1D*) file->Get("momentumH");
-    TH1D *discordantInvMassH = (TH1D*) file->Get("discordantInvMassH");
-    TH1D *concordantInvMassH = (TH1D*) file->Get("concordantInvMassH");
     TH1D *discordantPionKaonInvMassH = (TH1D*) file->Get("discordantPionKaonInvMassH");
     TH1D *concordantPionKaonInvMassH = (TH1D*) file->Get("concordantPionKaonInvMassH");
     TH1D *daughtersInvMassH = (TH1D*) file->Get("daughtersInvMassH");
+    const int kStar = Particle::FindParticle("K*");
+    if (!particleTypesH || !discordantPionKaonInvMassH || !concordantPionKaonInvMassH || !daughtersInvMassH || kStar < 0) {
+        std::cout << "Cannot summarize " << fileName << ": missing histograms or K*" << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+    const double mass = Particle::GetMass(kStar), width = Particle::GetWidth(kStar);
+
+    TH1D *differenceH = (TH1D*) discordantPionKaonInvMassH->Clone("summaryDifferenceH");
+    differenceH->Add(concordantPionKaonInvMassH, -1.0);
+    TF1 *fit = FitBreitWigner(differenceH, mass, width);
+    summary.kStarMass = fit->GetParameter(1);
+    summary.kStarMassError = fit->GetParError(1);
+    summary.kStarWidth = abs(fit->GetParameter(2));
+    summary.kStarWidthError = fit->GetParError(2);
+    delete fit;
+    fit = FitBreitWigner(daughtersInvMassH, mass, width);
+    summary.daughtersMass = fit->GetParameter(1);
+    summary.daughtersMassError = fit->GetParError(1);
+    summary.daughtersWidth = abs(fit->GetParameter(2));
+    summary.daughtersWidthError = fit->GetParError(2);
+    delete fit;
+
+    summary.nChecks = 0;
+    summary.nFailedChecks = 0;
+    const double nPrimaries = particleTypesH->GetEntries();
+    const char *generationNames[] = {"azimutAngleH", "polarAngleH", "momentumH", "transverseMomentumH", "particleEnergyH"};
+    for (const char *name : generationNames) {
+        TH1D *h = (TH1D*) file->Get(name);
+        summary.nChecks++;
+        if (!h || h->GetEntries() != nPrimaries) {
+            std::cout << "Number of entries of " << name << " is incorrect" << std::endl;
+            summary.nFailedChecks++;
+        }
+    }
+
+    // With importance weights w, the weighted count of a species of probability p has variance
+    // nPrimaries * p * (w - p), which is the binomial one for unit weights
+    vector<double> probabilities = SpeciesProbabilities();
+    const vector<double> weights = SpeciesWeights();
+    double sum = 0;
+    for (double p : probabilities)
+        sum += p;
+    for (int i = 0; i < (int) probabilities.size() && i < particleTypesH->GetNbinsX(); i++) {
+        const double p = probabilities[i] / sum;
+        const double expected = nPrimaries * p;
+        const double w = weights.empty() ? 1 : weights[i];
+        summary.nChecks++;
+        if (abs(particleTypesH->GetBinContent(i + 1) - expected) > ERROR_FACTOR * sqrt(expected * (w - p))) {
+            std::cout << "Number of " << Particle::GetParticleType(i)->GetName() << " is incorrect" << std::endl;
+            summary.nFailedChecks++;
+        }
+    }
+
+    summary.nChecks++;
+    if (abs(summary.daughtersMass - mass) > ERROR_FACTOR * summary.daughtersMassError) {
+        std::cout << "Fitted K* mass " << summary.daughtersMass << " +/- " << summary.daughtersMassError << " differs from " << mass << std::endl;
+        summary.nFailedChecks++;
+    }
+
+    file->Close();
+    delete file;
+    return true;
+}
+
+// Analyze the histograms saved in gConfig.histogramsFile
+void AnalyzeData() {
+    if (!InitParticleTypes())
+        return;
+
+    // Open root file and retrieve histograms
+    PROFILE_SCOPE(kRead);
+    TFile *file = new TFile(gConfig.histogramsFile.c_str(), "READ");
+    Histograms histograms;
+    const bool ok = !file->IsZombie() && histograms.Read(file);
+    file->Close();
+    delete file;
+    PROFILE_STOP(kRead);
+    if (!ok) {
+        std::cout << "Cannot analyze: no valid histograms in " << gConfig.histogramsFile << std::endl;
+        return;
+    }
+    AnalyzeHistograms(histograms);
+}
+
+// Generate gConfig.nIterations events and analyze them straight from memory. The run is
+// also saved in gConfig.histogramsFile, unless empty, so that no file is needed at all
+void GenerateAndAnalyze(int nThreads, unsigned int seed, const char *eventsFileName) {
+    RunInfo info;
+    Histograms *histograms = GenerateHistograms(info, nThreads, seed, eventsFileName);
+    if (!histograms)
+        return;
+    if (!gConfig.histogramsFile.empty())
+        WriteRun(gConfig.histogramsFile, *histograms, info);
+    AnalyzeHistograms(*histograms);
+    delete histograms;
+}
+
+// Fit and plot the histograms of a run, as generated or read back from a file
+void AnalyzeHistograms(const Histograms &histograms) {
+    gROOT->SetBatch();
+    TH1D *particleTypesH = (TH1D*) histograms.particleTypesH->ToTH1();
+    TH1D *azimutAngleH = (TH1D*) histograms.azimutAngleH->ToTH1();
+    TH1D *polarAngleH = (TH1D*) histograms.polarAngleH->ToTH1();
+    TH1D *momentumH = (TH1D*) histograms.momentumH->ToTH1();
+    TH1D *discordantInvMassH = (TH1D*) histograms.discordantInvMassH->ToTH1();
+    TH1D *concordantInvMassH = (TH1D*) histograms.concordantInvMassH->ToTH1();
+    TH1D *discordantPionKaonInvMassH = (TH1D*) histograms.discordantPionKaonInvMassH->ToTH1();
+    TH1D *concordantPionKaonInvMassH = (TH1D*) histograms.concordantPionKaonInvMassH->ToTH1();
+    TH1D *daughtersInvMassH = (TH1D*) histograms.daughtersInvMassH->ToTH1();
+    TH1D *mixedPionKaonInvMassH = (TH1D*) histograms.mixedPionKaonInvMassH->ToTH1();
 
     // Set styles for histograms
     gStyle->SetOptStat("e");
     gStyle->SetOptFit(1111);
     particleTypesH->SetFillColor(kBlue);
 
-    // Set axes labels
-    particleTypesH->GetXaxis()->SetBinLabel(PION_PLUS_BIN, "#pi+");
-    particleTypesH->GetXaxis()->SetBinLabel(PION_MINUS_BIN, "#pi-");
-    particleTypesH->GetXaxis()->SetBinLabel(KAON_PLUS_BIN, "K+");
-    particleTypesH->GetXaxis()->SetBinLabel(KAON_MINUS_BIN, "K-");
-    particleTypesH->GetXaxis()->SetBinLabel(PROTON_PLUS_BIN, "p+");
-    particleTypesH->GetXaxis()->SetBinLabel(PROTON_MINUS_BIN, "p+");
-    particleTypesH->GetXaxis()->SetBinLabel(KAON_STAR_BIN, "K*");
+    // Set axes labels, one bin per particle type of the catalog (bin = species id + 1)
+    const int nTypes = min(particleTypesH->GetNbinsX(), Particle::GetNParticleTypes());
+    for (int i = 0; i < nTypes; i++) {
+        string label = Particle::GetParticleType(i)->GetName();
+        const size_t pi = label.find("π");
+        if (pi != string::npos)
+            label.replace(pi, string("π").size(), "#pi");
+        particleTypesH->GetXaxis()->SetBinLabel(i + 1, label.c_str());
+    }
     particleTypesH->GetYaxis()->SetTitle("Occurrences");
 
     azimutAngleH->GetXaxis()->SetTitle("Angle (rad)");
@@ -66,8 +202,8 @@ void AnalyzeData() {
 
     // Output partile type occurrences for the report table
     cout << "Particle type occurrences:" << endl;
-    for (int i = 1; i <= N_PARTICLE_TYPES; i++)
-        cout << "\t" << LABELS[i - 1] << " " << particleTypesH->GetBinContent(i) << " +/- " << particleTypesH->GetBinError(i) << endl;
+    for (int i = 1; i <= nTypes; i++)
+        cout << "\t" << Particle::GetParticleType(i - 1)->GetName() << " " << particleTypesH->GetBinContent(i) << " +/- " << particleTypesH->GetBinError(i) << endl;
 
     // Convert occurrencies into frequency density
     azimutAngleH->Scale(1.0 / azimutAngleH->Integral("width"));
@@ -76,10 +212,16 @@ void AnalyzeData() {
     daughtersInvMassH->Scale(1.0 / daughtersInvMassH->Integral("width"));
     
     // Fit histograms with the right distribution
+    PROFILE_SCOPE(kFits);
     azimutAngleH->Fit("pol0", "Q");         // Uniform
     polarAngleH->Fit("pol0", "Q");          // Uniform
     momentumH->Fit("expo", "Q");            // Exponential
-    daughtersInvMassH->Fit("gaus", "Q");    // Normal
+    const int kStar = Particle::FindParticle("K*");
+    if (kStar >= 0) {
+        // Breit-Wigner, drawn from the copy kept by the histogram
+        TF1 *daughtersFit = FitBreitWigner(daughtersInvMassH, Particle::GetMass(kStar), Particle::GetWidth(kStar));
+        delete daughtersFit;
+    }
 
     // Output mean for momentum fit distribution
     TF1 *momentumFit = momentumH->GetFunction("expo");
@@ -91,7 +233,7 @@ void AnalyzeData() {
     // Check consistency of invariant mass histograms
     TH1D *pionKaonDiscordantMinusConcordantH = (TH1D*) discordantPionKaonInvMassH->Clone("pionKaonDiscordantMinusConcordantH");
     pionKaonDiscordantMinusConcordantH->Add(concordantPionKaonInvMassH, -1.0);
-    pionKaonDiscordantMinusConcordantH->Fit("gaus", "Q");
+    FitGaussianPeak(pionKaonDiscordantMinusConcordantH);
     pionKaonDiscordantMinusConcordantH->SetTitle("Discordant-Concordant Pion/Kaon Invariant Mass Difference");
 
     TH1D *discordantMinusConcordantH = (TH1D*) discordantInvMassH->Clone("discordantMinusConcordantH");
@@ -99,7 +241,23 @@ void AnalyzeData() {
     discordantMinusConcordantH->Fit("gaus", "Q");
     discordantMinusConcordantH->SetTitle("Discordant-Concordant Invariant Mass Difference");
 
+    // Subtract the mixed-event background, normalized to the discordant pion/kaon pairs outside the K* region
+    TH1D *pionKaonDiscordantMinusMixedH = (TH1D*) discordantPionKaonInvMassH->Clone("pionKaonDiscordantMinusMixedH");
+    const int minPeakBin = discordantPionKaonInvMassH->FindBin(gConfig.minPeakInvariantMass);
+    const int maxPeakBin = discordantPionKaonInvMassH->FindBin(gConfig.maxPeakInvariantMass);
+    const double discordantSidebands = discordantPionKaonInvMassH->Integral(1, minPeakBin - 1) + discordantPionKaonInvMassH->Integral(maxPeakBin + 1, gConfig.nBinsInvMass);
+    const double mixedSidebands = mixedPionKaonInvMassH ? mixedPionKaonInvMassH->Integral(1, minPeakBin - 1) + mixedPionKaonInvMassH->Integral(maxPeakBin + 1, gConfig.nBinsInvMass) : 0;
+    if (mixedSidebands > 0) {
+        pionKaonDiscordantMinusMixedH->Add(mixedPionKaonInvMassH, -discordantSidebands / mixedSidebands);
+        pionKaonDiscordantMinusMixedH->Fit("gaus", "Q");
+    }
+    pionKaonDiscordantMinusMixedH->SetTitle("Discordant Pion/Kaon Minus Mixed Events Invariant Mass");
+    pionKaonDiscordantMinusMixedH->GetXaxis()->SetTitle("Mass (GeV/c^{2})");
+
+    PROFILE_STOP(kFits);
+
     // Save histograms in files for the final report
+    PROFILE_SCOPE(kPlots);
     TCanvas *c1 = new TCanvas();
     c1->Divide(2, 2);
     c1->cd(1);
@@ -113,16 +271,28 @@ void AnalyzeData() {
     c1->SaveAs("./histograms/typesAndMomentum.tikz.tex");
 
     gStyle->SetOptStat(0);
-    TCanvas *c2 = new TCanvas("c2", "Invariant Mass", 600, 800);
-    c2->Divide(1, 3);
+    TCanvas *c2 = new TCanvas("c2", "Invariant Mass", 600, 1000);
+    c2->Divide(1, 4);
     c2->cd(1);
     daughtersInvMassH->Draw();
     c2->cd(2);
     discordantMinusConcordantH->Draw();
     c2->cd(3);
     pionKaonDiscordantMinusConcordantH->Draw();
+    c2->cd(4);
+    pionKaonDiscordantMinusMixedH->Draw();
     c2->SaveAs("./histograms/invMass.tikz.tex");
+    PROFILE_STOP(kPlots);
 
-    // Close root file
-    file->Close();
+    // Free histograms and canvases
+    TH1 *all[] = {
+        particleTypesH, azimutAngleH, polarAngleH, momentumH, discordantInvMassH, concordantInvMassH,
+        discordantPionKaonInvMassH, concordantPionKaonInvMassH, daughtersInvMassH, mixedPionKaonInvMassH,
+        pionKaonDiscordantMinusConcordantH, discordantMinusConcordantH, pionKaonDiscordantMinusMixedH
+    };
+    delete c1;
+    delete c2;
+    for (TH1 *h : all)
+        delete h;
+    PROFILE_REPORT("analysis");
 }
\ No newline at end of file
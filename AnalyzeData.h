@@ -0,0 +1,32 @@
+#include "Histograms.h"
+
+#include <string>
+
+#ifndef ANALYZE_DATA_H
+#define ANALYZE_DATA_H
+
+using namespace std;
+
+class TF1;
+class TH1;
+class TH1D;
+
+// Results of a run used to compare runs, e.g. the points of a scan: Breit-Wigner fits of the
+// K* peak and consistency checks of the histograms, as in Checks
+struct RunSummary {
+    double kStarMass, kStarMassError;           // Fit of discordant minus concordant pion/kaon pairs
+    double kStarWidth, kStarWidthError;
+    double daughtersMass, daughtersMassError;   // Fit of the pairs of daughters of two-body decays
+    double daughtersWidth, daughtersWidthError;
+    int nChecks;
+    int nFailedChecks;
+};
+
+void AnalyzeData();
+void AnalyzeHistograms(const Histograms &histograms);
+void GenerateAndAnalyze(int nThreads = 1, unsigned int seed = 4357, const char *eventsFileName = 0);
+TF1 *FitBreitWigner(TH1D *h, double mass, double width);
+TF1 *FitGaussianPeak(TH1 *h);
+bool SummarizeRun(const string fileName, RunSummary &summary);
+
+#endif
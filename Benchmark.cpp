@@ -0,0 +1,283 @@
+#include "AliasSampler.h"
+#include "Config.h"
+#include "EventBuffer.h"
+#include "GenerateParticles.h"
+#include "Histograms.h"
+#include "PairTable.h"
+#include "Particle.h"
+#include "Parameters.h"
+#include "PhiloxRandom.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <TROOT.h>
+
+using namespace std;
+
+// Benchmarks of the physics kernels and of the whole event loop. Every benchmark uses a
+// fixed seed and runs a warmup pass before being timed, results are printed and saved in
+// JSON (benchmark.json unless another file is given as argument). Run parameters are read
+// as in the main executable (--key=value, --config=file)
+
+static const unsigned int BENCHMARK_SEED = 4357;
+static const int N_KERNEL_OPERATIONS = 1000000;
+static const int N_BENCHMARK_EVENTS = 2000;
+
+static volatile double gSink;   // Keeps the benchmarked results alive
+
+static double Seconds(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Time nOperations calls of operation(i) after a warmup of nOperations / 10 calls, in ns per call
+template <class Operation>
+static double NsPerOperation(Operation operation, int nOperations) {
+    double sum = 0;
+    for (int i = 0; i < nOperations / 10; i++)
+        sum += operation(i);
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < nOperations; i++)
+        sum += operation(i);
+    const double seconds = Seconds(start);
+    gSink = sum;
+    return seconds * 1E9 / nOperations;
+}
+
+struct KernelResult {
+    string name;
+    double nsPerOperation;
+};
+
+struct LoopResult {
+    int nThreads;
+    int nParticles;
+    Long64_t nEvents;
+    double pairs;
+    double seconds;
+};
+
+// Time of the invariant masses of an event buffer of scalar type T, in ns per pair
+template <typename T>
+static double InvMassesNs(const vector<Particle> &particles, int nRows) {
+    const int nParticles = particles.size(), mask = nParticles - 1;
+    EventBufferT<T> buffer(nParticles);
+    buffer.Load(particles.data(), nParticles);
+    vector<T> masses(nParticles);
+    return NsPerOperation([&](int i) {
+        buffer.InvMasses(i & mask, 0, nParticles, masses.data());
+        return (double) masses[i & mask];
+    }, nRows) / nParticles;
+}
+
+static vector<KernelResult> RunKernels() {
+    vector<KernelResult> results;
+    PhiloxRandom rng(BENCHMARK_SEED);
+
+    // Random particles shared by the kernels, with an index cycling over the stable species
+    vector<int> stable;
+    for (int i = 0; i < Particle::GetNParticleTypes(); i++)
+        if (Particle::GetNDecayChannels(i) == 0)
+            stable.push_back(i);
+    const int nParticles = 1024;
+    vector<Particle> particles(nParticles);
+    for (int i = 0; i < nParticles; i++) {
+        particles[i].SetIndex(stable[i % stable.size()]);
+        particles[i].SetP(rng.Gaus(), rng.Gaus(), rng.Gaus());
+    }
+    vector<double> uniforms(nParticles);
+    for (int i = 0; i < nParticles; i++)
+        uniforms[i] = rng.Rndm();
+    const int mask = nParticles - 1;
+
+    results.push_back({"Particle::TotEnergy", NsPerOperation([&](int i) {
+        return particles[i & mask].TotEnergy();
+    }, N_KERNEL_OPERATIONS)});
+
+    results.push_back({"Particle::InvMass", NsPerOperation([&](int i) {
+        return particles[i & mask].InvMass(&particles[(i + 1) & mask]);
+    }, N_KERNEL_OPERATIONS)});
+
+    Particle boosted = particles[0];
+    results.push_back({"Particle::Boost", NsPerOperation([&](int i) {
+        boosted = particles[i & mask];
+        boosted.Boost(0.1, -0.2, 0.3);
+        return boosted.GetPx();
+    }, N_KERNEL_OPERATIONS)});
+
+    Particle kaonStar;
+    kaonStar.SetIndex("K*");
+    Particle dau1, dau2;
+    dau1.SetIndex("π+");
+    dau2.SetIndex("K-");
+    results.push_back({"Particle::Decay2Body", NsPerOperation([&](int i) {
+        kaonStar.SetP(particles[i & mask].GetPx(), particles[i & mask].GetPy(), particles[i & mask].GetPz());
+        kaonStar.Decay2Body(dau1, dau2, &rng);
+        return dau1.GetPx() + dau2.GetPx();
+    }, N_KERNEL_OPERATIONS)});
+
+    // Batch of decays of all the resonances of an event, per decay
+    const int nDecays = 64;
+    vector<Particle> event(3 * nDecays);
+    vector<int> mothers(nDecays), daughters1(nDecays), daughters2(nDecays);
+    for (int k = 0; k < nDecays; k++) {
+        event[k] = kaonStar;
+        event[k].SetP(particles[k].GetPx(), particles[k].GetPy(), particles[k].GetPz());
+        event[nDecays + 2 * k] = dau1;
+        event[nDecays + 2 * k + 1] = dau2;
+        mothers[k] = k;
+        daughters1[k] = nDecays + 2 * k;
+        daughters2[k] = nDecays + 2 * k + 1;
+    }
+    results.push_back({"Particle::Decay2Body (batch)", NsPerOperation([&](int i) {
+        Particle::Decay2Body(event.data(), mothers.data(), daughters1.data(), daughters2.data(), nDecays, &rng);
+        return event[nDecays + (i & (2 * nDecays - 1))].GetPx();
+    }, N_KERNEL_OPERATIONS / nDecays) / nDecays});
+
+    results.push_back({"PhiloxRandom::Rndm", NsPerOperation([&](int i) {
+        return rng.Rndm();
+    }, N_KERNEL_OPERATIONS)});
+
+    // Batched draws, per number
+    vector<double> batch(PhiloxRandom::fBatchSize);
+    const int nBatches = N_KERNEL_OPERATIONS / PhiloxRandom::fBatchSize;
+    results.push_back({"PhiloxRandom::Uniforms", NsPerOperation([&](int i) {
+        rng.Uniforms(batch.data(), PhiloxRandom::fBatchSize);
+        return batch[i & (PhiloxRandom::fBatchSize - 1)];
+    }, nBatches) / PhiloxRandom::fBatchSize});
+    results.push_back({"PhiloxRandom::Exponentials", NsPerOperation([&](int i) {
+        rng.Exponentials(batch.data(), PhiloxRandom::fBatchSize, AVG_P);
+        return batch[i & (PhiloxRandom::fBatchSize - 1)];
+    }, nBatches) / PhiloxRandom::fBatchSize});
+    results.push_back({"PhiloxRandom::Gaussians", NsPerOperation([&](int i) {
+        rng.Gaussians(batch.data(), PhiloxRandom::fBatchSize);
+        return batch[i & (PhiloxRandom::fBatchSize - 1)];
+    }, nBatches) / PhiloxRandom::fBatchSize});
+
+    const AliasSampler speciesSampler(SpeciesProbabilities());
+    results.push_back({"AliasSampler::Sample", NsPerOperation([&](int i) {
+        return (double) speciesSampler.Sample(uniforms[i & mask]);
+    }, N_KERNEL_OPERATIONS)});
+    vector<int> sampled(nParticles);
+    results.push_back({"AliasSampler::Sample (batch)", NsPerOperation([&](int i) {
+        speciesSampler.Sample(nParticles, uniforms.data(), sampled.data());
+        return (double) sampled[i & mask];
+    }, N_KERNEL_OPERATIONS / nParticles) / nParticles});
+
+    // Invariant masses of one particle with all the others of an event, per pair, in both precisions
+    const int nRows = N_KERNEL_OPERATIONS / nParticles;
+    results.push_back({"EventBufferT<double>::InvMasses", InvMassesNs<double>(particles, nRows)});
+    results.push_back({"EventBufferT<float>::InvMasses", InvMassesNs<float>(particles, nRows)});
+    EventBuffer buffer(nParticles);
+
+    // Kinematics of the primaries of an event, per particle
+    vector<int> species(nParticles);
+    vector<double> p(nParticles), theta(nParticles), phi(nParticles), pt(nParticles);
+    for (int i = 0; i < nParticles; i++) {
+        species[i] = particles[i].GetIndex();
+        p[i] = rng.Exp(AVG_P);
+        theta[i] = rng.Uniform(0, M_PI);
+        phi[i] = rng.Uniform(0, 2 * M_PI);
+    }
+    results.push_back({"EventBuffer::SetPrimaries", NsPerOperation([&](int i) {
+        buffer.SetPrimaries(nParticles, species.data(), p.data(), theta.data(), phi.data(), pt.data());
+        return pt[i & mask];
+    }, nRows) / nParticles});
+
+    return results;
+}
+
+// Simulate nEvents events split among nThreads threads, as the chunks of a generation run,
+// with nParticles primaries each; the configured number is restored afterwards
+static LoopResult RunLoop(const PairTable &pairTable, int nThreads, int nParticles, Long64_t nEvents) {
+    const int configuredParticles = gConfig.nParticlesPerIteration;
+    gConfig.nParticlesPerIteration = nParticles;
+    vector<Histograms *> histograms(nThreads);
+    for (int t = 0; t < nThreads; t++)
+        histograms[t] = new Histograms();
+
+    auto worker = [&](int t, int n) {
+        PhiloxRandom rng(BENCHMARK_SEED);
+        GenerateEvents(*histograms[t], pairTable, &rng, (Long64_t) t * n, n);
+    };
+
+    // Warmup
+    worker(0, max<Long64_t>(1, nEvents / nThreads / 10));
+    histograms[0]->Reset();
+
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(worker, t, nEvents / nThreads));
+    worker(0, nEvents / nThreads);
+    for (thread &t : threads)
+        t.join();
+    const double seconds = Seconds(start);
+
+    // Every pair of particles fills the invariant mass histogram once
+    LoopResult result = {nThreads, nParticles, nEvents / nThreads * nThreads, 0, seconds};
+    for (int t = 0; t < nThreads; t++) {
+        result.pairs += histograms[t]->invMassH->GetEntries();
+        delete histograms[t];
+    }
+    gConfig.nParticlesPerIteration = configuredParticles;
+    return result;
+}
+
+static string ToJson(const vector<KernelResult> &kernels, const vector<LoopResult> &loops) {
+    stringstream json;
+    json.precision(6);
+    json << "{" << endl << "  \"kernels\": [" << endl;
+    for (size_t i = 0; i < kernels.size(); i++)
+        json << "    {\"name\": \"" << kernels[i].name << "\", \"nsPerOp\": " << kernels[i].nsPerOperation << "}" << (i + 1 < kernels.size() ? "," : "") << endl;
+    json << "  ]," << endl << "  \"eventLoop\": [" << endl;
+    for (size_t i = 0; i < loops.size(); i++) {
+        const LoopResult &l = loops[i];
+        json << "    {\"threads\": " << l.nThreads << ", \"particlesPerEvent\": " << l.nParticles <<
+                ", \"events\": " << l.nEvents << ", \"seconds\": " << l.seconds <<
+                ", \"eventsPerSecond\": " << l.nEvents / l.seconds <<
+                ", \"pairsPerSecond\": " << l.pairs / l.seconds << "}" << (i + 1 < loops.size() ? "," : "") << endl;
+    }
+    json << "  ]" << endl << "}" << endl;
+    return json.str();
+}
+
+int main(int argc, char **argv) {
+    vector<string> arguments;
+    if (!gConfig.ParseArguments(argc, argv, arguments))
+        return 1;
+    const string outputFileName = arguments.empty() ? "benchmark.json" : arguments[0];
+
+    if (!InitParticleTypes())
+        return 1;
+    ROOT::EnableThreadSafety();
+
+    vector<KernelResult> kernels = RunKernels();
+    for (const KernelResult &k : kernels)
+        std::cout << k.name << ": " << k.nsPerOperation << " ns/op" << std::endl;
+
+    // Scaling with the event multiplicity on one thread, then with the number of threads at the
+    // configured multiplicity
+    const PairTable pairTable;
+    vector<LoopResult> loops;
+    const int multiplicities[] = {25, 50, 100, 200, 400};
+    for (int nParticles : multiplicities)
+        loops.push_back(RunLoop(pairTable, 1, nParticles, N_BENCHMARK_EVENTS * N_PARTICLES_PER_ITERATION / nParticles));
+    const int maxThreads = max(1u, thread::hardware_concurrency());
+    for (int nThreads = 2; nThreads <= maxThreads; nThreads *= 2)
+        loops.push_back(RunLoop(pairTable, nThreads, gConfig.nParticlesPerIteration, (Long64_t) N_BENCHMARK_EVENTS * nThreads));
+    for (const LoopResult &l : loops)
+        std::cout << "Event loop, " << l.nThreads << " threads, " << l.nParticles << " particles: " <<
+                     l.nEvents / l.seconds << " events/s, " << l.pairs / l.seconds << " pairs/s" << std::endl;
+
+    ofstream output(outputFileName.c_str());
+    output << ToJson(kernels, loops);
+    std::cout << "Results saved in " << outputFileName << std::endl;
+    return 0;
+}
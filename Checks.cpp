@@ -1,20 +1,121 @@
-void Checks() {
+#include "Checks.h"
 
+#include "Config.h"
+#include "GenerateParticles.h"
+#include "Parameters.h"
+#include "Particle.h"
 
+#include <TH1.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 
-    // Check number of entries of generation histograms
-    if (particleTypesH->GetEntries() != N_PARTICLES_PER_ITERATION * N_ITERATIONS)
+using namespace std;
+
+// Sum of the weights of the entries, underflow and overflow included: the number of entries
+// of an unweighted histogram, and its unbiased estimate in importance weighted runs
+static double SumOfWeights(const TH1 *h) {
+    return h->Integral(0, h->GetNbinsX() + 1);
+}
+
+// Moments of the number M of primaries of an event (see MultiplicityProbabilities): its mean
+// and variance, the mean of M(M - 1), to which the numbers of pairs are proportional, and the
+// variance of M(M - 1) not explained by its linear dependence on M, which the numbers of
+// particles of the run already account for
+struct MultiplicityMoments {
+    double mean;
+    double variance;
+    double pairs;
+    double pairsVariance;
+};
+
+static MultiplicityMoments GetMultiplicityMoments() {
+    const vector<double> probabilities = MultiplicityProbabilities();
+    if (probabilities.empty()) {
+        const double n = gConfig.nParticlesPerIteration;
+        return {n, 0, n * (n - 1), 0};
+    }
+    double sum = 0, m1 = 0, m2 = 0, m3 = 0, m4 = 0;
+    for (size_t n = 0; n < probabilities.size(); n++) {
+        sum += probabilities[n];
+        m1 += probabilities[n] * n;
+        m2 += probabilities[n] * n * n;
+        m3 += probabilities[n] * n * n * n;
+        m4 += probabilities[n] * n * n * n * n;
+    }
+    m1 /= sum;
+    m2 /= sum;
+    m3 /= sum;
+    m4 /= sum;
+    const double variance = m2 - m1 * m1;
+    const double pairs = m2 - m1;
+    const double pairsVariance = m4 - 2 * m3 + m2 - pairs * pairs;
+    const double covariance = m3 - m2 - pairs * m1;
+    return {m1, variance, pairs, variance > 0 ? max(pairsVariance - covariance * covariance / variance, 0.0) : 0};
+}
+
+// Check the numbers of entries of the histograms of nEvents events against those expected
+// from the generated species, within ERROR_FACTOR standard deviations, and return the
+// number of failed checks. Primaries are drawn independently, so that the expected numbers
+// of pairs of an event follow from the mean of M(M - 1) of the multiplicity distribution; they
+// assume resonances decaying in a charged pion and a kaon of opposite charge, as in the
+// default catalog
+int Checks(const Histograms &histograms, Long64_t nEvents) {
+    const double nIterations = nEvents;
+    const MultiplicityMoments multiplicity = GetMultiplicityMoments();
+    const double nPrimaries = multiplicity.mean * nIterations;
+    const double nPrimariesErr = sqrt(multiplicity.variance * nIterations);
+    int nFailed = 0;
+
+    TH1 *particleTypesH = histograms.particleTypesH->ToTH1();
+    TH1 *finalParticleTypesH = histograms.finalParticleTypesH->ToTH1();
+    TH1 *azimutAngleH = histograms.azimutAngleH->ToTH1();
+    TH1 *polarAngleH = histograms.polarAngleH->ToTH1();
+    TH1 *momentumH = histograms.momentumH->ToTH1();
+    TH1 *transverseMomentumH = histograms.transverseMomentumH->ToTH1();
+    TH1 *particleEnergyH = histograms.particleEnergyH->ToTH1();
+    TH1 *invMassH = histograms.invMassH->ToTH1();
+    TH1 *discordantInvMassH = histograms.discordantInvMassH->ToTH1();
+    TH1 *concordantInvMassH = histograms.concordantInvMassH->ToTH1();
+    TH1 *discordantPionKaonInvMassH = histograms.discordantPionKaonInvMassH->ToTH1();
+    TH1 *concordantPionKaonInvMassH = histograms.concordantPionKaonInvMassH->ToTH1();
+    TH1 *daughtersInvMassH = histograms.daughtersInvMassH->ToTH1();
+
+    // Bins of the particle types, from their species ids in the catalog
+    const int PION_PLUS_BIN = Particle::FindParticle("π+") + 1;
+    const int PION_MINUS_BIN = Particle::FindParticle("π-") + 1;
+    const int KAON_PLUS_BIN = Particle::FindParticle("K+") + 1;
+    const int KAON_MINUS_BIN = Particle::FindParticle("K-") + 1;
+    const int PROTON_PLUS_BIN = Particle::FindParticle("p+") + 1;
+    const int PROTON_MINUS_BIN = Particle::FindParticle("p-") + 1;
+    const int KAON_STAR_BIN = Particle::FindParticle("K*") + 1;
+
+    // Check number of entries of generation histograms: all of them have an entry per primary
+    const double nGenerated = particleTypesH->GetEntries();
+    if (abs(nGenerated - nPrimaries) > ERROR_FACTOR * nPrimariesErr) {
         cout << "Number of entries of Particle Types Histogram is incorrect" << endl;
-    if (azimutAngleH->GetEntries() != N_PARTICLES_PER_ITERATION * N_ITERATIONS)
+        nFailed++;
+    }
+    if (azimutAngleH->GetEntries() != nGenerated) {
         cout << "Number of entries of Azimut Angle Histogram is incorrect" << endl;
-    if (polarAngleH->GetEntries() != N_PARTICLES_PER_ITERATION * N_ITERATIONS)
+        nFailed++;
+    }
+    if (polarAngleH->GetEntries() != nGenerated) {
         cout << "Number of entries of Polar Angle Histogram is incorrect" << endl;
-    if (momentumH->GetEntries() != N_PARTICLES_PER_ITERATION * N_ITERATIONS)
+        nFailed++;
+    }
+    if (momentumH->GetEntries() != nGenerated) {
         cout << "Number of entries of Momentum Histogram is incorrect" << endl;
-    if (transverseMomentumH->GetEntries() != N_PARTICLES_PER_ITERATION * N_ITERATIONS)
+        nFailed++;
+    }
+    if (transverseMomentumH->GetEntries() != nGenerated) {
         cout << "Number of entries of Transverse Momentum Histogram is incorrect" << endl;
-    if (particleEnergyH->GetEntries() != N_PARTICLES_PER_ITERATION * N_ITERATIONS)
+        nFailed++;
+    }
+    if (particleEnergyH->GetEntries() != nGenerated) {
         cout << "Number of entries of Particle Energy Histogram is incorrect" << endl;
+        nFailed++;
+    }
 
     // Alias number of particles for each type and respective errors
     const double nPionPlus = finalParticleTypesH->GetBinContent(PION_PLUS_BIN);
@@ -41,93 +142,118 @@ void Checks() {
     const double nProtonMinusRelativeErr = nProtonMinusErr / nProtonMinus;
     const double nKaonStarRelativeErr = nKaonStarErr / nKaonStar;
 
-    // Compute derived stats of combined particles and respective errors
-    const double nFinalParticlesPerIteration = (N_PARTICLES_PER_ITERATION * N_ITERATIONS + nKaonStar) / N_ITERATIONS;
-    const double nFinalParticlesPerIterationErr = nKaonStarErr / N_ITERATIONS;
+    // Primaries as counted by the histograms: nPrimaries, or in importance weighted runs their
+    // sum of weights, which fluctuates around it
+    const double nCountedPrimaries = SumOfWeights(particleTypesH);
+    double nCountedPrimariesErr = 0;
+    if (particleTypesH->GetSumw2N() > 0) {
+        for (int bin = 0; bin <= particleTypesH->GetNbinsX() + 1; bin++)
+            nCountedPrimariesErr += pow(particleTypesH->GetBinError(bin), 2);
+        nCountedPrimariesErr = sqrt(nCountedPrimariesErr);
+    }
+
+    // Compute derived stats of combined particles and respective errors. Pairs of different
+    // primaries number pairsRatio times the product of the particles per event, within
+    // pairsRelativeErr from the fluctuations of M(M - 1); each resonance adds the pair of its
+    // daughters, discordant and of a pion and a kaon
+    const double pairsRatio = multiplicity.pairs / (multiplicity.mean * multiplicity.mean);
+    const double pairsRelativeErr = multiplicity.pairs > 0 ? sqrt(multiplicity.pairsVariance * nIterations) / (multiplicity.pairs * nIterations) : 0;
+    const double nKaonStarPerIteration = nKaonStar / nIterations;
+
+    const double nFinalParticlesPerIteration = (nCountedPrimaries + nKaonStar) / nIterations;
+    const double nFinalParticlesPerIterationErr = (nCountedPrimariesErr + nKaonStarErr) / nIterations;
     const double nFinalParticlesPerIterationRelativeErr = nFinalParticlesPerIterationErr / nFinalParticlesPerIteration;
 
-    const double nPairs = (nFinalParticlesPerIteration * (nFinalParticlesPerIteration - 1) / 2) * N_ITERATIONS;
-    const double nPairsErr = 2 * nFinalParticlesPerIterationErr / nFinalParticlesPerIteration * nPairs;
-    const double nPairsRelativeErr = nPairsErr / nPairs;
-    
-    const double nPositiveParticlesPerIteration = (nPionPlus + nKaonPlus + nProtonPlus) / N_ITERATIONS;
-    const double nPositiveParticlesPerIterationErr = (nPionPlusErr + nKaonPlusErr + nProtonPlusErr) / N_ITERATIONS;
+    const double nPairs = (pairsRatio * nFinalParticlesPerIteration * nFinalParticlesPerIteration / 2 + nKaonStarPerIteration) * nIterations;
+    const double nPairsErr = (2 * nFinalParticlesPerIterationRelativeErr + pairsRelativeErr) * nPairs;
+
+    const double nPositiveParticlesPerIteration = (nPionPlus + nKaonPlus + nProtonPlus) / nIterations;
+    const double nPositiveParticlesPerIterationErr = (nPionPlusErr + nKaonPlusErr + nProtonPlusErr) / nIterations;
     const double nPositiveParticlesPerIterationRelativeErr = nPositiveParticlesPerIterationErr / nPositiveParticlesPerIteration;
     
-    const double nNegativeParticlesPerIteration = (nPionMinus + nKaonMinus + nProtonMinus) / N_ITERATIONS;
-    const double nNegativeParticlesPerIterationErr = (nPionMinusErr + nKaonMinusErr + nProtonMinusErr) / N_ITERATIONS;
+    const double nNegativeParticlesPerIteration = (nPionMinus + nKaonMinus + nProtonMinus) / nIterations;
+    const double nNegativeParticlesPerIterationErr = (nPionMinusErr + nKaonMinusErr + nProtonMinusErr) / nIterations;
     const double nNegativeParticlesPerIterationRelativeErr = nNegativeParticlesPerIterationErr / nNegativeParticlesPerIteration;
     
-    const double nDiscordantPairs = nPositiveParticlesPerIteration * nNegativeParticlesPerIteration * N_ITERATIONS;
-    const double nDiscordantPairsRelativeErr = nPositiveParticlesPerIterationRelativeErr + nNegativeParticlesPerIterationRelativeErr;
+    const double nDiscordantPairs = (pairsRatio * nPositiveParticlesPerIteration * nNegativeParticlesPerIteration + nKaonStarPerIteration) * nIterations;
+    const double nDiscordantPairsRelativeErr = nPositiveParticlesPerIterationRelativeErr + nNegativeParticlesPerIterationRelativeErr + pairsRelativeErr;
     const double nDiscordantPairsErr = nDiscordantPairsRelativeErr * nDiscordantPairs;
 
-    const double nConcordantPairs = ((nPositiveParticlesPerIteration * (nPositiveParticlesPerIteration - 1) / 2) +
-                                     (nNegativeParticlesPerIteration * (nNegativeParticlesPerIteration - 1) / 2)) *
-                                    N_ITERATIONS;
-    const double nConcordantPairsRelativeErr = 2 * (nPositiveParticlesPerIterationRelativeErr + nNegativeParticlesPerIterationRelativeErr);
+    const double nConcordantPairs = pairsRatio * ((nPositiveParticlesPerIteration * nPositiveParticlesPerIteration / 2) +
+                                                  (nNegativeParticlesPerIteration * nNegativeParticlesPerIteration / 2)) *
+                                    nIterations;
+    const double nConcordantPairsRelativeErr = 2 * (nPositiveParticlesPerIterationRelativeErr + nNegativeParticlesPerIterationRelativeErr) + pairsRelativeErr;
     const double nConcordantPairsErr = nConcordantPairsRelativeErr * nConcordantPairs;
 
-    const double nPositivePionsPerIteration = nPionPlus / N_ITERATIONS;
-    const double nPositivePionsPerIterationErr = nPionPlusErr / N_ITERATIONS;
-    const double nPositivePionsPerIterationRelativeErr = nPionPlusRelativeErr;
-
-    const double nNegativePionsPerIteration = nPionMinus / N_ITERATIONS;
-    const double nNegativePionsPerIterationErr = nPionMinusErr / N_ITERATIONS;
-    const double nNegativePionsPerIterationRelativeErr = nPionMinusRelativeErr;
-    
-    const double nPositiveKaonsPerIteration = nKaonPlus / N_ITERATIONS;
-    const double nPositiveKaonsPerIterationErr = nKaonPlusErr / N_ITERATIONS;
-    const double nPositiveKaonsPerIterationRelativeErr = nKaonPlusRelativeErr;
-
-    const double nNegativeKaonsPerIteration = nKaonMinus / N_ITERATIONS;
-    const double nNegativeKaonsPerIterationErr = nKaonMinusErr / N_ITERATIONS;
-    const double nNegativeKaonsPerIterationRelativeErr = nKaonMinusRelativeErr;
+    const double nPositivePionsPerIteration = nPionPlus / nIterations;
+    const double nNegativePionsPerIteration = nPionMinus / nIterations;
+    const double nPositiveKaonsPerIteration = nKaonPlus / nIterations;
+    const double nNegativeKaonsPerIteration = nKaonMinus / nIterations;
 
-    const double nDiscordantPionKaonPairs = (nPositivePionsPerIteration * nNegativeKaonsPerIteration / 2 +
-                                             nNegativePionsPerIteration * nPositiveKaonsPerIteration / 2) *
-                                            N_ITERATIONS;
+    const double nDiscordantPionKaonPairs = (pairsRatio * (nPositivePionsPerIteration * nNegativeKaonsPerIteration +
+                                                           nNegativePionsPerIteration * nPositiveKaonsPerIteration) +
+                                             nKaonStarPerIteration) *
+                                            nIterations;
     const double nPositivePionNegativeKaonPairsRelativeErr = nPionPlusRelativeErr + nKaonMinusRelativeErr;
     const double nPositivePionNegativeKaonPairsErr = nPositivePionNegativeKaonPairsRelativeErr * nPositivePionsPerIteration * nNegativeKaonsPerIteration;
     const double nNegativePionPositiveKaonPairsRelativeErr = nPionMinusRelativeErr + nKaonPlusRelativeErr;
     const double nNegativePionPositiveKaonPairsErr = nNegativePionPositiveKaonPairsRelativeErr * nNegativePionsPerIteration * nPositiveKaonsPerIteration;
-    const double nDiscordantPionKaonPairsErr = (nPositivePionNegativeKaonPairsErr + nNegativePionPositiveKaonPairsErr) * N_ITERATIONS;
+    const double nDiscordantPionKaonPairsErr = (nPositivePionNegativeKaonPairsErr + nNegativePionPositiveKaonPairsErr) * nIterations + pairsRelativeErr * nDiscordantPionKaonPairs;
 
-    const double nConcordantPionKaonPairs = (nPositivePionsPerIteration * nPositiveKaonsPerIteration / 2 +
-                                             nNegativePionsPerIteration * nNegativeKaonsPerIteration / 2) *
-                                            N_ITERATIONS;
+    const double nConcordantPionKaonPairs = pairsRatio * (nPositivePionsPerIteration * nPositiveKaonsPerIteration +
+                                                          nNegativePionsPerIteration * nNegativeKaonsPerIteration) *
+                                            nIterations;
     const double nPositivePionPositiveKaonPairsRelativeErr = nPionPlusRelativeErr + nKaonPlusRelativeErr;
     const double nPositivePionPositiveKaonPairsErr = nPositivePionPositiveKaonPairsRelativeErr * nPositivePionsPerIteration * nPositiveKaonsPerIteration;
     const double nNegativePionNegativeKaonPairsRelativeErr = nPionMinusRelativeErr + nKaonMinusRelativeErr;
     const double nNegativePionNegativeKaonPairsErr = nNegativePionNegativeKaonPairsRelativeErr * nNegativePionsPerIteration * nNegativeKaonsPerIteration;
-    const double nConcordantPionKaonPairsErr = (nPositivePionPositiveKaonPairsErr + nNegativePionNegativeKaonPairsErr) * N_ITERATIONS;
+    const double nConcordantPionKaonPairsErr = (nPositivePionPositiveKaonPairsErr + nNegativePionNegativeKaonPairsErr) * nIterations + pairsRelativeErr * nConcordantPionKaonPairs;
 
     const double nTotParticles = nPionPlus + nPionMinus + nKaonPlus + nKaonMinus + nProtonPlus + nProtonMinus + nKaonStar;
     const double nTotParticlesErr = nPionPlusErr + nPionMinusErr + nKaonPlusErr + nKaonMinusErr + nProtonPlusErr + nProtonMinusErr + nKaonStarErr;
 
-    const double nDaughters = nTotParticles - N_PARTICLES_PER_ITERATION * N_ITERATIONS;
-    const double nDaughtersErr = nTotParticlesErr;
+    const double nDaughters = nTotParticles - nCountedPrimaries;
+    const double nDaughtersErr = nTotParticlesErr + nCountedPrimariesErr;
 
     const double nDaughterPairs = nDaughters / 2;
     const double nDaughterPairsErr = nDaughtersErr / 2;
 
     // Check number of entries of invariant mass histograms
-    if (abs(invMassH->GetEntries() - nPairs) > ERROR_FACTOR * nPairsErr)
+    if (abs(SumOfWeights(invMassH) - nPairs) > ERROR_FACTOR * nPairsErr) {
         cout << "Number of entries of Invariant Mass Histogram is incorrect" << endl;
+        nFailed++;
+    }
 
-    if (abs(discordantInvMassH->GetEntries() - nDiscordantPairs) > ERROR_FACTOR * nDiscordantPairsErr)
+    if (abs(SumOfWeights(discordantInvMassH) - nDiscordantPairs) > ERROR_FACTOR * nDiscordantPairsErr) {
         cout << "Number of entries of discordant invariant mass histogram is incorrect" << endl;
+        nFailed++;
+    }
 
-    if (abs(concordantInvMassH->GetEntries() - nConcordantPairs) > ERROR_FACTOR * nConcordantPairsErr)
+    if (abs(SumOfWeights(concordantInvMassH) - nConcordantPairs) > ERROR_FACTOR * nConcordantPairsErr) {
         cout << "Number of entries of concordant invariant mass histogram is incorrect" << endl;
+        nFailed++;
+    }
 
-    if (abs(discordantPionKaonInvMassH->GetEntries() - nDiscordantPionKaonPairs) > ERROR_FACTOR * nDiscordantPionKaonPairsErr)
+    if (abs(SumOfWeights(discordantPionKaonInvMassH) - nDiscordantPionKaonPairs) > ERROR_FACTOR * nDiscordantPionKaonPairsErr) {
         cout << "Number of entries of discordant pion/kaon invariant mass histogram is incorrect" << endl;
+        nFailed++;
+    }
     
-    if (abs(concordantPionKaonInvMassH->GetEntries() - nConcordantPionKaonPairs) > ERROR_FACTOR * nConcordantPionKaonPairsErr)
+    if (abs(SumOfWeights(concordantPionKaonInvMassH) - nConcordantPionKaonPairs) > ERROR_FACTOR * nConcordantPionKaonPairsErr) {
         cout << "Number of entries of concordant pion/kaon invariant mass histogram is incorrect" << endl;
+        nFailed++;
+    }
 
-    if (abs(daughtersInvMassH->GetEntries() - nDaughterPairs) > ERROR_FACTOR * nDaughterPairsErr)
+    if (abs(SumOfWeights(daughtersInvMassH) - nDaughterPairs) > ERROR_FACTOR * nDaughterPairsErr) {
         cout << "Number of entries of daughters invariant mass histogram is incorrect" << endl;
+        nFailed++;
+    }
 
-}
\ No newline at end of file
+    TH1 *all[] = {
+        particleTypesH, finalParticleTypesH, azimutAngleH, polarAngleH, momentumH, transverseMomentumH, particleEnergyH,
+        invMassH, discordantInvMassH, concordantInvMassH, discordantPionKaonInvMassH, concordantPionKaonInvMassH, daughtersInvMassH
+    };
+    for (TH1 *h : all)
+        delete h;
+    return nFailed;
+}
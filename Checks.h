@@ -0,0 +1,10 @@
+#include "Histograms.h"
+
+#ifndef CHECKS_H
+#define CHECKS_H
+
+using namespace std;
+
+int Checks(const Histograms &histograms, Long64_t nEvents);
+
+#endif
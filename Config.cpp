@@ -0,0 +1,280 @@
+#include "Config.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+Config gConfig;
+
+// Most configuration files read inside one another
+static const size_t MAX_CONFIG_DEPTH = 16;
+
+Config::Config() {
+    nIterations = N_ITERATIONS;
+    nParticlesPerIteration = N_PARTICLES_PER_ITERATION;
+    nEventsPerChunk = N_EVENTS_PER_CHUNK;
+    avgP = AVG_P;
+    nBins = N_BINS;
+    nBinsInvMass = N_BINS_INV_MASS;
+    maxMomentum = MAX_MOMENTUM;
+    maxEnergy = MAX_ENERGY;
+    minInvariantMass = MIN_INVARIANT_MASS;
+    maxInvariantMass = MAX_INVARIANT_MASS;
+    mixingDepth = MIXING_DEPTH;
+    momentumResolution = MOMENTUM_RESOLUTION;
+    minPeakInvariantMass = MIN_PEAK_INVARIANT_MASS;
+    maxPeakInvariantMass = MAX_PEAK_INVARIANT_MASS;
+    checkpointInterval = CHECKPOINT_INTERVAL;
+    adaptiveInterval = ADAPTIVE_INTERVAL;
+    targetMassError = TARGET_MASS_ERROR;
+    targetWidthError = TARGET_WIDTH_ERROR;
+    multiplicity = "fixed";
+    nJobs = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+    seed = 4357;
+    nThreads = 1;
+    particlesFile = PARTICLES_FILE;
+    histogramsFile = HISTOGRAMS_FILE;
+    checkpointFile = CHECKPOINT_FILE;
+    traceFile = TRACE_FILE;
+}
+
+// Set result to the number in value if it is at least min, or above it if strict, otherwise
+// report the value of key as invalid and return false
+template <typename T>
+static bool SetNumber(const string key, const string value, T &result, T min, bool strict = false) {
+    T number;
+    if (!ParseNumber(value, number) || !(strict ? number > min : number >= min)) {
+        std::cout << "Invalid " << key << " " << value << ": expected a number " << (strict ? "above " : "of at least ") << min << std::endl;
+        return false;
+    }
+    result = number;
+    return true;
+}
+
+// Values of a comma separated list of non-negative numbers
+static bool ParseList(const string key, const string value, vector<double> &values) {
+    vector<double> list;
+    stringstream stream(value);
+    string item;
+    while (getline(stream, item, ',')) {
+        double number;
+        if (!SetNumber(key, item, number, 0.0))
+            return false;
+        list.push_back(number);
+    }
+    values = list;
+    return true;
+}
+
+// Set the parameter key from its value, checked to be valid: counts are positive, sizes and
+// probabilities non-negative. Invalid values are reported and leave the parameter unchanged
+bool Config::Set(const string key, const string value) {
+    double number;
+    if (key == "nIterations")
+        return SetNumber(key, value, nIterations, 1LL);
+    else if (key == "nParticlesPerIteration")
+        return SetNumber(key, value, nParticlesPerIteration, 1);
+    else if (key == "nEventsPerChunk")
+        return SetNumber(key, value, nEventsPerChunk, 1);
+    else if (key == "avgP")
+        return SetNumber(key, value, avgP, 0.0, true);
+    else if (key == "nBins")
+        return SetNumber(key, value, nBins, 1);
+    else if (key == "nBinsInvMass")
+        return SetNumber(key, value, nBinsInvMass, 1);
+    else if (key == "maxMomentum")
+        return SetNumber(key, value, maxMomentum, 0.0, true);
+    else if (key == "maxEnergy")
+        return SetNumber(key, value, maxEnergy, 0.0, true);
+    else if (key == "minInvariantMass")
+        return SetNumber(key, value, minInvariantMass, 0.0);
+    else if (key == "maxInvariantMass")
+        return SetNumber(key, value, maxInvariantMass, 0.0, true);
+    else if (key == "mixingDepth")
+        return SetNumber(key, value, mixingDepth, 0);
+    else if (key == "momentumResolution")
+        return SetNumber(key, value, momentumResolution, 0.0);
+    else if (key == "minPeakInvariantMass")
+        return SetNumber(key, value, minPeakInvariantMass, 0.0);
+    else if (key == "maxPeakInvariantMass")
+        return SetNumber(key, value, maxPeakInvariantMass, 0.0);
+    else if (key == "checkpointInterval")
+        return SetNumber(key, value, checkpointInterval, 0);
+    else if (key == "adaptiveInterval")
+        return SetNumber(key, value, adaptiveInterval, 1);
+    else if (key == "targetMassError")
+        return SetNumber(key, value, targetMassError, 0.0, true);
+    else if (key == "targetWidthError")
+        return SetNumber(key, value, targetWidthError, 0.0, true);
+    else if (key == "seed")
+        return SetNumber(key, value, seed, 0u);
+    else if (key == "nThreads")
+        return SetNumber(key, value, nThreads, 1);
+    else if (key == "particlesFile")
+        particlesFile = value;
+    else if (key == "histogramsFile")
+        histogramsFile = value;
+    else if (key == "checkpointFile")
+        checkpointFile = value;
+    else if (key == "eventsFile")
+        eventsFile = value;
+    else if (key == "profileFile")
+        profileFile = value;
+    else if (key == "traceFile")
+        traceFile = value;
+    else if (key == "probabilities")
+        return ParseList(key, value, probabilities);
+    else if (key == "multiplicity") {
+        if (value != "fixed" && value != "poisson" && value != "table") {
+            std::cout << "Unknown multiplicity " << value << ": expected fixed, poisson or table" << std::endl;
+            return false;
+        }
+        multiplicity = value;
+    } else if (key == "multiplicityProbabilities")
+        return ParseList(key, value, multiplicityProbabilities);
+    else if (key.compare(0, 5, "mass:") == 0) {
+        if (!SetNumber(key, value, number, 0.0))
+            return false;
+        particleMasses[key.substr(5)] = number;
+    } else if (key.compare(0, 6, "width:") == 0) {
+        if (!SetNumber(key, value, number, 0.0))
+            return false;
+        particleWidths[key.substr(6)] = number;
+    } else if (key.compare(0, 5, "bias:") == 0) {
+        if (!SetNumber(key, value, number, 0.0, true))
+            return false;
+        particleBiases[key.substr(5)] = number;
+    }
+    else if (key == "nJobs")
+        return SetNumber(key, value, nJobs, 1);
+    else if (key == "config")
+        return ReadFile(value);
+    else {
+        std::cout << "Unknown parameter " << key << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static string Trim(const string s) {
+    const size_t begin = s.find_first_not_of(" \t\r");
+    const size_t end = s.find_last_not_of(" \t\r");
+    return begin == string::npos ? "" : s.substr(begin, end - begin + 1);
+}
+
+// Apply the "key = value" lines of a configuration file, which can read others with the
+// config key, up to MAX_CONFIG_DEPTH files deep and never one of those being read
+bool Config::ReadFile(const string fileName) {
+    if (find(fReadFiles.begin(), fReadFiles.end(), fileName) != fReadFiles.end() || fReadFiles.size() >= MAX_CONFIG_DEPTH) {
+        std::cout << "Cannot read configuration file " << fileName << ": configuration files include each other" << std::endl;
+        return false;
+    }
+    ifstream file(fileName.c_str());
+    if (!file) {
+        std::cout << "Cannot open configuration file " << fileName << std::endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+        const size_t equal = line.find('=');
+        if (equal == string::npos) {
+            std::cout << fileName << ":" << lineNumber << ": expected key = value" << std::endl;
+            return false;
+        }
+        fReadFiles.push_back(fileName);
+        const bool set = Set(Trim(line.substr(0, equal)), Trim(line.substr(equal + 1)));
+        fReadFiles.pop_back();
+        if (!set)
+            return false;
+    }
+    return true;
+}
+
+// Apply "--key=value" arguments in order; other arguments are returned in positional
+bool Config::ParseArguments(int argc, char **argv, vector<string> &positional) {
+    for (int i = 1; i < argc; i++) {
+        const string argument = argv[i];
+        if (argument.compare(0, 2, "--") != 0) {
+            positional.push_back(argument);
+            continue;
+        }
+        const size_t equal = argument.find('=');
+        if (equal == string::npos) {
+            std::cout << "Expected --key=value, got " << argument << std::endl;
+            return false;
+        }
+        if (!Set(argument.substr(2, equal - 2), argument.substr(equal + 1)))
+            return false;
+    }
+    return CheckRanges();
+}
+
+// Whether the ranges given by pairs of parameters, which can be set in any order, are not
+// empty, reporting those that are
+bool Config::CheckRanges() const {
+    if (!(minInvariantMass < maxInvariantMass)) {
+        std::cout << "Invalid invariant mass range: minInvariantMass " << minInvariantMass << " is not below maxInvariantMass " << maxInvariantMass << std::endl;
+        return false;
+    }
+    if (!(minPeakInvariantMass < maxPeakInvariantMass)) {
+        std::cout << "Invalid peak range: minPeakInvariantMass " << minPeakInvariantMass << " is not below maxPeakInvariantMass " << maxPeakInvariantMass << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Config::Print() const {
+    std::cout << "nIterations = " << nIterations << std::endl <<
+                 "nParticlesPerIteration = " << nParticlesPerIteration << std::endl <<
+                 "nEventsPerChunk = " << nEventsPerChunk << std::endl <<
+                 "avgP = " << avgP << std::endl <<
+                 "nBins = " << nBins << std::endl <<
+                 "nBinsInvMass = " << nBinsInvMass << std::endl <<
+                 "maxMomentum = " << maxMomentum << std::endl <<
+                 "maxEnergy = " << maxEnergy << std::endl <<
+                 "minInvariantMass = " << minInvariantMass << std::endl <<
+                 "maxInvariantMass = " << maxInvariantMass << std::endl <<
+                 "mixingDepth = " << mixingDepth << std::endl <<
+                 "momentumResolution = " << momentumResolution << std::endl <<
+                 "minPeakInvariantMass = " << minPeakInvariantMass << std::endl <<
+                 "maxPeakInvariantMass = " << maxPeakInvariantMass << std::endl <<
+                 "checkpointInterval = " << checkpointInterval << std::endl <<
+                 "adaptiveInterval = " << adaptiveInterval << std::endl <<
+                 "targetMassError = " << targetMassError << std::endl <<
+                 "targetWidthError = " << targetWidthError << std::endl <<
+                 "probabilities = ";
+    for (size_t i = 0; i < probabilities.size(); i++)
+        std::cout << (i > 0 ? "," : "") << probabilities[i];
+    std::cout << std::endl <<
+                 "multiplicity = " << multiplicity << std::endl <<
+                 "multiplicityProbabilities = ";
+    for (size_t i = 0; i < multiplicityProbabilities.size(); i++)
+        std::cout << (i > 0 ? "," : "") << multiplicityProbabilities[i];
+    std::cout << std::endl <<
+                 "seed = " << seed << std::endl <<
+                 "nThreads = " << nThreads << std::endl <<
+                 "particlesFile = " << particlesFile << std::endl <<
+                 "histogramsFile = " << histogramsFile << std::endl <<
+                 "checkpointFile = " << checkpointFile << std::endl <<
+                 "eventsFile = " << eventsFile << std::endl <<
+                 "profileFile = " << profileFile << std::endl <<
+                 "traceFile = " << traceFile << std::endl <<
+                 "nJobs = " << nJobs << std::endl;
+    for (map<string, double>::const_iterator it = particleMasses.begin(); it != particleMasses.end(); ++it)
+        std::cout << "mass:" << it->first << " = " << it->second << std::endl;
+    for (map<string, double>::const_iterator it = particleWidths.begin(); it != particleWidths.end(); ++it)
+        std::cout << "width:" << it->first << " = " << it->second << std::endl;
+    for (map<string, double>::const_iterator it = particleBiases.begin(); it != particleBiases.end(); ++it)
+        std::cout << "bias:" << it->first << " = " << it->second << std::endl;
+}
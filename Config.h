@@ -0,0 +1,99 @@
+#include "Parameters.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+using namespace std;
+
+// Run parameters, initialized with the defaults in Parameters.h and changeable at runtime
+// from a configuration file or from the command line, so that a parameter change does not
+// require a rebuild. Both use the same keys, as "key = value" lines (# starts a comment)
+// or "--key=value" arguments; probabilities are given as a comma separated list, one per
+// particle type of the catalog in particlesFile (empty for the abundances of the catalog).
+// The number of primaries of an event is nParticlesPerIteration with multiplicity "fixed",
+// Poisson distributed with that mean with "poisson", or n with probability given by the
+// n-th (from 0) of multiplicityProbabilities with "table". The catalog mass and width of a
+// particle type are overridden by "mass:<name>" and "width:<name>" keys, e.g. width:K*.
+// Importance sampling: "bias:<name>" multiplies the probability of drawing that species as a
+// primary, e.g. bias:K*, and histograms are filled with weights compensating it (see
+// SpeciesWeights), so that they keep the expectations of the unbiased generation.
+// The momenta of the particles seen by the pair analysis are smeared by the relative
+// resolution momentumResolution, 0 for none (see EventPipeline).
+// Adaptive runs fit the K* peak every adaptiveInterval events and stop when the errors of its
+// mean and sigma are below targetMassError and targetWidthError, or after nIterations events,
+// recording each fit in traceFile. With the instrumentation compiled in (see Profiler), the
+// profiles of generation and analysis are also appended in JSON to profileFile, unless empty
+class Config {
+    public:
+        Config();
+        bool Set(const string key, const string value);
+        bool ReadFile(const string fileName);
+        bool ParseArguments(int argc, char **argv, vector<string> &positional);
+        bool CheckRanges() const;
+        void Print() const;
+
+        long long nIterations;
+        int nParticlesPerIteration;
+        int nEventsPerChunk;
+        double avgP;
+        int nBins;
+        int nBinsInvMass;
+        double maxMomentum;
+        double maxEnergy;
+        double minInvariantMass;
+        double maxInvariantMass;
+        int mixingDepth;
+        double momentumResolution;
+        double minPeakInvariantMass;
+        double maxPeakInvariantMass;
+        int checkpointInterval;
+        int adaptiveInterval;
+        double targetMassError;
+        double targetWidthError;
+        vector<double> probabilities;
+        string multiplicity;
+        vector<double> multiplicityProbabilities;
+        unsigned int seed;
+        int nThreads;
+        string particlesFile;
+        string histogramsFile;
+        string checkpointFile;
+        string eventsFile;
+        string profileFile;
+        string traceFile;
+        map<string, double> particleMasses;
+        map<string, double> particleWidths;
+        map<string, double> particleBiases;
+        int nJobs;
+
+    private:
+        vector<string> fReadFiles;  // Configuration files being read, innermost last
+};
+
+extern Config gConfig;
+
+// Whole value as a number of type T, false if it is not one or does not fit in T
+template <typename T>
+inline bool ParseNumber(const string value, T &result) {
+    const char *begin = value.c_str();
+    char *end = 0;
+    errno = 0;
+    if (is_integral<T>::value) {
+        const long long number = strtoll(begin, &end, 10);
+        if (number < (long long) numeric_limits<T>::min() || (number > 0 && (unsigned long long) number > (unsigned long long) numeric_limits<T>::max()))
+            return false;
+        result = (T) number;
+    } else
+        result = (T) strtod(begin, &end);
+    return end != begin && *end == '\0' && errno == 0;
+}
+
+#endif
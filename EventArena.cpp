@@ -0,0 +1,41 @@
+#include "EventArena.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Grow a vector to at least n elements, at least doubling it
+template <typename T>
+static void Grow(vector<T> &v, size_t n) {
+    if (v.size() < n)
+        v.resize(max(n, 2 * v.size()));
+}
+
+EventArena::EventArena(int nPrimaries) : buffer(nPrimaries + MAX_PRODUCTS) {
+    ReservePrimaries(nPrimaries);
+    ReserveDecays(nPrimaries);
+}
+
+void EventArena::ReservePrimaries(int nPrimaries) {
+    Grow(phis, nPrimaries);
+    Grow(thetas, nPrimaries);
+    Grow(momenta, nPrimaries);
+    Grow(uniforms, nPrimaries);
+    Grow(transverseMomenta, nPrimaries);
+    Grow(species, nPrimaries);
+}
+
+// Make room for the decays of a generation of at most nMothers resonances, each followed
+// by up to three daughters
+void EventArena::ReserveDecays(int nMothers) {
+    Grow(decays, 4 * nMothers);
+    Grow(mothers, nMothers);
+    Grow(dau1, nMothers);
+    Grow(dau2, nMothers);
+    Grow(parents, nMothers);
+    Grow(positions, nMothers);
+}
+
+void EventArena::ReserveWeights(int nParticles) {
+    Grow(weights, nParticles);
+}
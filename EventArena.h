@@ -0,0 +1,42 @@
+#include "EventBuffer.h"
+#include "Parameters.h"
+#include "Particle.h"
+
+#include <vector>
+
+#ifndef EVENT_ARENA_H
+#define EVENT_ARENA_H
+
+using namespace std;
+
+// Storage of the events generated by a thread, reused from one event to the next: the event
+// buffer, with primaries, decay products and their parent links, and the scratch arrays of
+// the primaries and of the decays. Everything grows geometrically to the largest event seen,
+// so that in the steady state generating an event allocates nothing
+class EventArena {
+    public:
+        EventArena(int nPrimaries = N_PARTICLES_PER_ITERATION);
+        void ReservePrimaries(int nPrimaries);
+        void ReserveDecays(int nMothers);
+        void ReserveWeights(int nParticles);
+
+        EventBuffer buffer;
+
+        // Primaries: angles, momenta, uniforms of the species draws, transverse momenta, species ids
+        vector<double> phis, thetas, momenta, uniforms, transverseMomenta;
+        vector<int> species;
+
+        // Resonances of a generation of the event, each followed by its daughters, and the
+        // positions of the two-body decays in it, which are done together
+        vector<Particle> decays;
+        vector<int> mothers, dau1, dau2, parents, positions;
+
+        // Importance weights of the particles of the buffer, in weighted generation (see SpeciesWeights)
+        vector<double> weights;
+
+    private:
+        EventArena(const EventArena &) = delete;
+        EventArena &operator=(const EventArena &) = delete;
+};
+
+#endif
@@ -0,0 +1,304 @@
+#include "EventBuffer.h"
+
+#include "FastMath.h"
+#include "ParticleType.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Arrays are padded to a multiple of 64 bytes (one AVX-512 register of doubles or floats)
+static const int kAlignment = 64;
+
+template <typename T>
+static int PaddedSize(int n) {
+    const int nPerRegister = kAlignment / sizeof(T);
+    return (n + nPerRegister - 1) / nPerRegister * nPerRegister;
+}
+
+template <typename T>
+T *EventBufferT<T>::AllocateArray(int n) {
+    return static_cast<T *>(aligned_alloc(kAlignment, PaddedSize<T>(n) * sizeof(T)));
+}
+
+template <typename T>
+void EventBufferT<T>::FreeArray(T *array) {
+    free(array);
+}
+
+template <typename T>
+EventBufferT<T>::EventBufferT(int capacity) : fCapacity(0), fSize(0), fNPrimaries(0),
+    fPx(0), fPy(0), fPz(0), fE(0), fMass(0), fCharge(0), fIndex(0), fParent(0) {
+    Reserve(capacity);
+}
+
+template <typename T>
+EventBufferT<T>::~EventBufferT() {
+    FreeArray(fPx);
+    FreeArray(fPy);
+    FreeArray(fPz);
+    FreeArray(fE);
+    FreeArray(fMass);
+    free(fCharge);
+    free(fIndex);
+    free(fParent);
+}
+
+// Move an array to a new allocation of the given capacity, keeping its first n elements
+template <typename U>
+static void Grow(U *&array, int n, int capacity) {
+    const size_t bytes = (PaddedSize<U>(capacity) * sizeof(U) + kAlignment - 1) / kAlignment * kAlignment;
+    U *grown = static_cast<U *>(aligned_alloc(kAlignment, bytes));
+    if (n > 0)
+        copy(array, array + n, grown);
+    free(array);
+    array = grown;
+}
+
+// Make room for at least capacity particles, keeping the current ones. The capacity at
+// least doubles on each growth, so that a buffer reused across events soon stops growing
+template <typename T>
+void EventBufferT<T>::Reserve(int capacity) {
+    if (capacity <= fCapacity)
+        return;
+    capacity = max(capacity, 2 * fCapacity);
+    Grow(fPx, fSize, capacity);
+    Grow(fPy, fSize, capacity);
+    Grow(fPz, fSize, capacity);
+    Grow(fE, fSize, capacity);
+    Grow(fMass, fSize, capacity);
+    Grow(fCharge, fSize, capacity);
+    Grow(fIndex, fSize, capacity);
+    Grow(fParent, fSize, capacity);
+    fCapacity = capacity;
+}
+
+template <typename T>
+void EventBufferT<T>::Load(const Particle *particles, int n, const int *parents) {
+    SetSize(n);
+    for (int i = 0; i < fSize; i++)
+        Set(i, particles[i].GetPx(), particles[i].GetPy(), particles[i].GetPz(), particles[i].GetIndex(), parents ? parents[i] : -1);
+    fNPrimaries = 0;
+    while (fNPrimaries < fSize && fParent[fNPrimaries] < 0)
+        fNPrimaries++;
+}
+
+// The energy is computed in double from the given momentum, then both are rounded to T
+template <typename T>
+void EventBufferT<T>::Set(int i, double px, double py, double pz, int index, int parent) {
+    const double mass = Particle::GetMass(index);
+    fPx[i] = px;
+    fPy[i] = py;
+    fPz[i] = pz;
+    fE[i] = sqrt(mass * mass + px * px + py * py + pz * pz);
+    fMass[i] = mass;
+    fCharge[i] = Particle::GetCharge(index);
+    fIndex[i] = index;
+    fParent[i] = parent;
+}
+
+// Append a particle, growing the buffer if needed, and return its position
+template <typename T>
+int EventBufferT<T>::Add(double px, double py, double pz, int index, int parent) {
+    Reserve(fSize + 1);
+    Set(fSize, px, py, pz, index, parent);
+    return fSize++;
+}
+
+// Start an event with n primaries of the given species, with momenta of modulus p and polar
+// and azimuthal angles theta and phi, also returning their transverse momenta. Masses and
+// charges are looked up first, so the kinematics is a branch-free vectorized loop, in double
+template <typename T>
+void EventBufferT<T>::SetPrimaries(int n, const int *index, const double *p, const double *theta, const double *phi, double *pt) {
+    fSize = 0;
+    Reserve(n);
+    fSize = fNPrimaries = n;
+    for (int i = 0; i < n; i++) {
+        fMass[i] = Particle::GetMass(index[i]);
+        fCharge[i] = Particle::GetCharge(index[i]);
+        fIndex[i] = index[i];
+        fParent[i] = -1;
+    }
+
+    // Output arrays never overlap the inputs: telling the compiler avoids runtime alias checks
+    T *px = fPx, *py = fPy, *pz = fPz, *e = fE;
+    const T *mass = fMass;
+#pragma GCC ivdep
+    for (int i = 0; i < n; i++) {
+        double sinTheta, cosTheta, sinPhi, cosPhi;
+        SinCos(theta[i], sinTheta, cosTheta);
+        SinCos(phi[i], sinPhi, cosPhi);
+        const double m = mass[i];
+        pt[i] = p[i] * sinTheta;
+        px[i] = pt[i] * cosPhi;
+        py[i] = pt[i] * sinPhi;
+        pz[i] = p[i] * cosTheta;
+        e[i] = sqrt(m * m + p[i] * p[i]);
+    }
+}
+
+// Set the number of particles, growing the buffer if needed; new ones must then be Set
+template <typename T>
+void EventBufferT<T>::SetSize(int n) {
+    Reserve(n);
+    fSize = n;
+    fNPrimaries = min(fNPrimaries, n);
+}
+
+template <typename T>
+int EventBufferT<T>::GetSize() const {
+    return fSize;
+}
+
+template <typename T>
+int EventBufferT<T>::GetNPrimaries() const {
+    return fNPrimaries;
+}
+
+template <typename T>
+int EventBufferT<T>::GetCapacity() const {
+    return fCapacity;
+}
+
+template <typename T>
+const T *EventBufferT<T>::GetPx() const {
+    return fPx;
+}
+
+template <typename T>
+const T *EventBufferT<T>::GetPy() const {
+    return fPy;
+}
+
+template <typename T>
+const T *EventBufferT<T>::GetPz() const {
+    return fPz;
+}
+
+template <typename T>
+const T *EventBufferT<T>::GetE() const {
+    return fE;
+}
+
+template <typename T>
+const T *EventBufferT<T>::GetMass() const {
+    return fMass;
+}
+
+template <typename T>
+const int *EventBufferT<T>::GetCharge() const {
+    return fCharge;
+}
+
+template <typename T>
+const int *EventBufferT<T>::GetIndex() const {
+    return fIndex;
+}
+
+template <typename T>
+const int *EventBufferT<T>::GetParent() const {
+    return fParent;
+}
+
+template <typename T>
+T EventBufferT<T>::InvMass(int i, int k) const {
+    const T e = fE[i] + fE[k];
+    const T px = fPx[i] + fPx[k];
+    const T py = fPy[i] + fPy[k];
+    const T pz = fPz[i] + fPz[k];
+    return sqrt(e * e - (px * px + py * py + pz * pz));
+}
+
+// Vectorized part of InvMasses: the invariant masses with the particles from k on, in whole
+// registers, returning the first k left to the scalar loop. Uses AVX-512 or AVX2 when the
+// translation unit is compiled for it, with twice as many lanes for float
+static int InvMassesVector(double e1, double px1, double py1, double pz1, const double *fE, const double *fPx, const double *fPy, const double *fPz, int k, int end, double *out) {
+#if defined(__AVX512F__)
+    const __m512d ve1 = _mm512_set1_pd(e1);
+    const __m512d vpx1 = _mm512_set1_pd(px1);
+    const __m512d vpy1 = _mm512_set1_pd(py1);
+    const __m512d vpz1 = _mm512_set1_pd(pz1);
+    for (; k + 8 <= end; k += 8, out += 8) {
+        const __m512d e = _mm512_add_pd(ve1, _mm512_loadu_pd(fE + k));
+        const __m512d px = _mm512_add_pd(vpx1, _mm512_loadu_pd(fPx + k));
+        const __m512d py = _mm512_add_pd(vpy1, _mm512_loadu_pd(fPy + k));
+        const __m512d pz = _mm512_add_pd(vpz1, _mm512_loadu_pd(fPz + k));
+        const __m512d p2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(px, px), _mm512_mul_pd(py, py)), _mm512_mul_pd(pz, pz));
+        _mm512_storeu_pd(out, _mm512_sqrt_pd(_mm512_sub_pd(_mm512_mul_pd(e, e), p2)));
+    }
+#elif defined(__AVX2__)
+    const __m256d ve1 = _mm256_set1_pd(e1);
+    const __m256d vpx1 = _mm256_set1_pd(px1);
+    const __m256d vpy1 = _mm256_set1_pd(py1);
+    const __m256d vpz1 = _mm256_set1_pd(pz1);
+    for (; k + 4 <= end; k += 4, out += 4) {
+        const __m256d e = _mm256_add_pd(ve1, _mm256_loadu_pd(fE + k));
+        const __m256d px = _mm256_add_pd(vpx1, _mm256_loadu_pd(fPx + k));
+        const __m256d py = _mm256_add_pd(vpy1, _mm256_loadu_pd(fPy + k));
+        const __m256d pz = _mm256_add_pd(vpz1, _mm256_loadu_pd(fPz + k));
+        const __m256d p2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(px, px), _mm256_mul_pd(py, py)), _mm256_mul_pd(pz, pz));
+        _mm256_storeu_pd(out, _mm256_sqrt_pd(_mm256_sub_pd(_mm256_mul_pd(e, e), p2)));
+    }
+#endif
+    return k;
+}
+
+static int InvMassesVector(float e1, float px1, float py1, float pz1, const float *fE, const float *fPx, const float *fPy, const float *fPz, int k, int end, float *out) {
+#if defined(__AVX512F__)
+    const __m512 ve1 = _mm512_set1_ps(e1);
+    const __m512 vpx1 = _mm512_set1_ps(px1);
+    const __m512 vpy1 = _mm512_set1_ps(py1);
+    const __m512 vpz1 = _mm512_set1_ps(pz1);
+    for (; k + 16 <= end; k += 16, out += 16) {
+        const __m512 e = _mm512_add_ps(ve1, _mm512_loadu_ps(fE + k));
+        const __m512 px = _mm512_add_ps(vpx1, _mm512_loadu_ps(fPx + k));
+        const __m512 py = _mm512_add_ps(vpy1, _mm512_loadu_ps(fPy + k));
+        const __m512 pz = _mm512_add_ps(vpz1, _mm512_loadu_ps(fPz + k));
+        const __m512 p2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(px, px), _mm512_mul_ps(py, py)), _mm512_mul_ps(pz, pz));
+        _mm512_storeu_ps(out, _mm512_sqrt_ps(_mm512_sub_ps(_mm512_mul_ps(e, e), p2)));
+    }
+#elif defined(__AVX2__)
+    const __m256 ve1 = _mm256_set1_ps(e1);
+    const __m256 vpx1 = _mm256_set1_ps(px1);
+    const __m256 vpy1 = _mm256_set1_ps(py1);
+    const __m256 vpz1 = _mm256_set1_ps(pz1);
+    for (; k + 8 <= end; k += 8, out += 8) {
+        const __m256 e = _mm256_add_ps(ve1, _mm256_loadu_ps(fE + k));
+        const __m256 px = _mm256_add_ps(vpx1, _mm256_loadu_ps(fPx + k));
+        const __m256 py = _mm256_add_ps(vpy1, _mm256_loadu_ps(fPy + k));
+        const __m256 pz = _mm256_add_ps(vpz1, _mm256_loadu_ps(fPz + k));
+        const __m256 p2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)), _mm256_mul_ps(pz, pz));
+        _mm256_storeu_ps(out, _mm256_sqrt_ps(_mm256_sub_ps(_mm256_mul_ps(e, e), p2)));
+    }
+#endif
+    return k;
+}
+
+// Invariant masses of particle i with each particle k in [begin, end), written in out[k - begin]
+template <typename T>
+void EventBufferT<T>::InvMasses(int i, int begin, int end, T *out) const {
+    InvMasses(fE[i], fPx[i], fPy[i], fPz[i], begin, end, out);
+}
+
+// Invariant masses of a particle with four-momentum (e, px, py, pz), possibly from another
+// event, with each particle k in [begin, end)
+template <typename T>
+void EventBufferT<T>::InvMasses(T e1, T px1, T py1, T pz1, int begin, int end, T *out) const {
+    int k = InvMassesVector(e1, px1, py1, pz1, fE, fPx, fPy, fPz, begin, end, out);
+
+    // Scalar fallback and remainder
+    for (; k < end; k++) {
+        const T e = e1 + fE[k];
+        const T px = px1 + fPx[k];
+        const T py = py1 + fPy[k];
+        const T pz = pz1 + fPz[k];
+        out[k - begin] = sqrt(e * e - (px * px + py * py + pz * pz));
+    }
+}
+
+template class EventBufferT<float>;
+template class EventBufferT<double>;
@@ -0,0 +1,66 @@
+#include "Particle.h"
+
+#ifndef EVENT_BUFFER_H
+#define EVENT_BUFFER_H
+
+using namespace std;
+
+// Scalar type of the kinematics stored in the event buffers and of the pair kernels: double,
+// or float when compiled with SINGLE_PRECISION defined (cmake -DSINGLE_PRECISION=ON), which
+// doubles the SIMD width and halves the memory traffic of the pair loops. Histogram binning
+// needs far less than single precision; decays and boosts are done in double regardless
+#ifdef SINGLE_PRECISION
+typedef float Real;
+#else
+typedef double Real;
+#endif
+
+// Structure-of-arrays copy of the particles of an event: momenta, energies, masses,
+// charges, species ids and parent links (position of the decayed resonance in the event,
+// -1 for primaries) are stored in separate contiguous 64-byte aligned arrays of T,
+// with the energy computed once per particle, to feed vectorized pair kernels. The primaries
+// come first, followed by the decay products; the buffer grows as particles are added.
+// Instantiated for float and double, EventBuffer is that of Real
+template <typename T>
+class EventBufferT {
+    public:
+        EventBufferT(int capacity);
+        ~EventBufferT();
+        void Load(const Particle *particles, int n, const int *parents = 0);
+        void Reserve(int capacity);
+        void Set(int i, double px, double py, double pz, int index, int parent = -1);
+        int Add(double px, double py, double pz, int index, int parent);
+        void SetPrimaries(int n, const int *index, const double *p, const double *theta, const double *phi, double *pt);
+        void SetSize(int n);
+        int GetSize() const;
+        int GetNPrimaries() const;
+        int GetCapacity() const;
+        const T *GetPx() const;
+        const T *GetPy() const;
+        const T *GetPz() const;
+        const T *GetE() const;
+        const T *GetMass() const;
+        const int *GetCharge() const;
+        const int *GetIndex() const;
+        const int *GetParent() const;
+        T InvMass(int i, int k) const;
+        void InvMasses(int i, int begin, int end, T *out) const;
+        void InvMasses(T e1, T px1, T py1, T pz1, int begin, int end, T *out) const;
+
+        static T *AllocateArray(int n);
+        static void FreeArray(T *array);
+
+    private:
+        int fCapacity;
+        int fSize;
+        int fNPrimaries;
+        T *fPx, *fPy, *fPz, *fE, *fMass;
+        int *fCharge, *fIndex, *fParent;
+
+        EventBufferT(const EventBufferT &) = delete;
+        EventBufferT &operator=(const EventBufferT &) = delete;
+};
+
+typedef EventBufferT<Real> EventBuffer;
+
+#endif
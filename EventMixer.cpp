@@ -0,0 +1,121 @@
+#include "EventMixer.h"
+
+#include "Histograms.h"
+#include "Particle.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+using namespace std;
+
+EventMixer::EventMixer(const PairTable &pairTable, int depth, int capacity) :
+    fDepth(depth), fCapacity(capacity), fNPooled(0), fNext(0) {
+    fNTypes = Particle::GetNParticleTypes();
+    fMix.assign(fNTypes * fNTypes, false);
+    fKeep.assign(fNTypes, false);
+    for (int i = 0; i < fNTypes; i++) {
+        for (int j = 0; j < fNTypes; j++) {
+            if (pairTable.IsTarget(i, j, Histograms::kDiscordantPionKaonInvMass)) {
+                fMix[i * fNTypes + j] = true;
+                fKeep[i] = true;
+            }
+        }
+    }
+
+    for (int d = 0; d < fDepth; d++)
+        fPool.push_back(new EventBuffer(capacity));
+    fWeights.assign(fDepth, vector<double>());
+    fOffsets.assign(fDepth, vector<int>(fNTypes + 1, 0));
+    fCursor.assign(fNTypes + 1, 0);
+    fInvMasses = EventBuffer::AllocateArray(capacity);
+    fPairWeights.assign(capacity, 0);
+}
+
+// Make room for pooled events of at least capacity particles, at least doubling the capacity
+void EventMixer::Reserve(int capacity) {
+    if (capacity <= fCapacity)
+        return;
+    fCapacity = max(capacity, 2 * fCapacity);
+    EventBuffer::FreeArray(fInvMasses);
+    fInvMasses = EventBuffer::AllocateArray(fCapacity);
+    fPairWeights.assign(fCapacity, 0);
+}
+
+EventMixer::~EventMixer() {
+    for (EventBuffer *pooled : fPool)
+        delete pooled;
+    EventBuffer::FreeArray(fInvMasses);
+}
+
+// Pair the event with the pooled ones, then store it in place of the oldest
+void EventMixer::Fill(FixedHistogram *h, const EventBuffer &buffer, const double *weights) {
+    if (fDepth == 0)
+        return;
+
+    const int n = buffer.GetSize();
+    const int *indices = buffer.GetIndex();
+    const Real *e = buffer.GetE();
+    const Real *px = buffer.GetPx();
+    const Real *py = buffer.GetPy();
+    const Real *pz = buffer.GetPz();
+
+    for (int p = 0; p < fNPooled; p++) {
+        const EventBuffer &other = *fPool[p];
+        const vector<int> &offsets = fOffsets[p];
+        const vector<double> &otherWeights = fWeights[p];
+        for (int i = 0; i < n; i++) {
+            if (!fKeep[indices[i]])
+                continue;
+            const int row = indices[i] * fNTypes;
+            for (int index = 0; index < fNTypes; index++) {
+                if (!fMix[row + index] || offsets[index] == offsets[index + 1])
+                    continue;
+                other.InvMasses(e[i], px[i], py[i], pz[i], offsets[index], offsets[index + 1], fInvMasses);
+                PROFILE_COUNT(Profiler::kPairsEvaluated, offsets[index + 1] - offsets[index]);
+                PROFILE_COUNT(Profiler::kPairsFilled + Histograms::kMixedPionKaonInvMass, offsets[index + 1] - offsets[index]);
+                if (weights) {
+                    for (int k = offsets[index]; k < offsets[index + 1]; k++)
+                        fPairWeights[k - offsets[index]] = weights[i] * otherWeights[k];
+                    h->FillN(offsets[index + 1] - offsets[index], fInvMasses, fPairWeights.data());
+                } else
+                    h->FillN(offsets[index + 1] - offsets[index], fInvMasses);
+            }
+        }
+    }
+
+    // Counting sort of the kept particles by species into the oldest slot
+    EventBuffer &slot = *fPool[fNext];
+    vector<int> &offsets = fOffsets[fNext];
+    fill(fCursor.begin(), fCursor.end(), 0);
+    for (int i = 0; i < n; i++)
+        if (fKeep[indices[i]])
+            fCursor[indices[i] + 1]++;
+    for (int index = 0; index < fNTypes; index++)
+        fCursor[index + 1] += fCursor[index];
+    for (int index = 0; index <= fNTypes; index++)
+        offsets[index] = fCursor[index];
+    Reserve(offsets[fNTypes]);
+    slot.SetSize(offsets[fNTypes]);
+    if (weights)
+        fWeights[fNext].resize(offsets[fNTypes]);
+    for (int i = 0; i < n; i++) {
+        if (fKeep[indices[i]]) {
+            if (weights)
+                fWeights[fNext][fCursor[indices[i]]] = weights[i];
+            slot.Set(fCursor[indices[i]]++, px[i], py[i], pz[i], indices[i]);
+        }
+    }
+
+    fNext = (fNext + 1) % fDepth;
+    if (fNPooled < fDepth)
+        fNPooled++;
+}
+
+void EventMixer::Clear() {
+    fNPooled = 0;
+    fNext = 0;
+}
+
+int EventMixer::GetDepth() const {
+    return fDepth;
+}
@@ -0,0 +1,47 @@
+#include "EventBuffer.h"
+#include "FixedHistogram.h"
+#include "PairTable.h"
+
+#include <vector>
+
+#ifndef EVENT_MIXER_H
+#define EVENT_MIXER_H
+
+using namespace std;
+
+// Mixed-event background: keeps the pion and kaon candidates of the last fDepth events in a
+// ring of buffers, grown to the largest events, and pairs each new event with all of them,
+// filling the mixed histogram with the pairs that would fill the discordant pion/kaon
+// histogram in the same event. Pooled particles are sorted by species, so that each particle
+// is only paired with the ranges of species it mixes with. Given the importance weights of
+// the particles, pairs are filled with the product of their weights
+class EventMixer {
+    public:
+        EventMixer(const PairTable &pairTable, int depth, int capacity);
+        ~EventMixer();
+        void Fill(FixedHistogram *h, const EventBuffer &buffer, const double *weights = 0);
+        void Clear();
+        int GetDepth() const;
+
+    private:
+        int fDepth;
+        int fCapacity;
+        int fNTypes;
+        vector<bool> fMix;
+        vector<bool> fKeep;
+        vector<EventBuffer *> fPool;
+        vector<vector<double>> fWeights;
+        vector<vector<int>> fOffsets;
+        vector<int> fCursor;
+        int fNPooled;
+        int fNext;
+        Real *fInvMasses;
+        vector<double> fPairWeights;
+
+        void Reserve(int capacity);
+
+        EventMixer(const EventMixer &) = delete;
+        EventMixer &operator=(const EventMixer &) = delete;
+};
+
+#endif
@@ -0,0 +1,273 @@
+#include "EventPipeline.h"
+
+#include "AliasSampler.h"
+#include "Config.h"
+#include "EventBuffer.h"
+#include "GenerateParticles.h"
+#include "PairAnalysis.h"
+#include "Particle.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Number of primaries, fixed or drawn from the multiplicity distribution, and their species
+// and momenta, computed straight in the event buffer, with their importance weights if biased
+class GenerationStage : public EventStage {
+    public:
+        GenerationStage() :
+            fSpeciesSampler(SamplingProbabilities()), fSpeciesWeights(SpeciesWeights()), fMultiplicities(MultiplicityProbabilities()),
+            fMultiplicitySampler(fMultiplicities.empty() ? vector<double>(1, 1.0) : fMultiplicities) {}
+
+        void Process(PipelineEvent &event) override {
+            PROFILE_SCOPE(kSampling);
+            EventArena &a = *event.arena;
+            PhiloxRandom *rng = event.rng;
+            const int nPrimaries = fMultiplicities.empty() ? gConfig.nParticlesPerIteration : fMultiplicitySampler.Sample(rng->Rndm());
+            a.ReservePrimaries(nPrimaries);
+            double *phis = a.phis.data(), *thetas = a.thetas.data(), *momenta = a.momenta.data();
+            double *uniforms = a.uniforms.data();
+            int *species = a.species.data();
+
+            // Random generation of momenta and species, in batches
+            rng->Uniforms(phis, nPrimaries, 0, 2*M_PI);
+            rng->Uniforms(thetas, nPrimaries, 0, M_PI);
+            rng->Exponentials(momenta, nPrimaries, gConfig.avgP);
+            rng->Uniforms(uniforms, nPrimaries);
+            fSpeciesSampler.Sample(nPrimaries, uniforms, species);
+
+            a.buffer.SetPrimaries(nPrimaries, species, momenta, thetas, phis, a.transverseMomenta.data());
+            event.nPrimaries = nPrimaries;
+            event.weighted = !fSpeciesWeights.empty();
+            event.transformed = false;
+            if (event.weighted) {
+                a.ReserveWeights(nPrimaries);
+                for (int j = 0; j < nPrimaries; j++)
+                    a.weights[j] = fSpeciesWeights[species[j]];
+            }
+        }
+
+    private:
+        const AliasSampler fSpeciesSampler;
+        const vector<double> fSpeciesWeights;
+        const vector<double> fMultiplicities;
+        const AliasSampler fMultiplicitySampler;
+};
+
+// Decayment of the resonances, each in a channel drawn from its decay table, one generation
+// at a time: daughters that are resonances decay in the next one and are appended after it,
+// so the buffer holds the primaries followed by each generation. Daughters inherit the weight
+// of their mother
+class DecayStage : public EventStage {
+    public:
+        void Process(PipelineEvent &event) override {
+            PROFILE_SCOPE(kDecays);
+            EventArena &a = *event.arena;
+            EventBuffer &buffer = a.buffer;
+            PhiloxRandom *rng = event.rng;
+            for (int first = 0, last = event.nPrimaries; first < last; first = last, last = buffer.GetSize()) {
+                a.ReserveDecays(last - first);
+                int nDecays = 0, nTwoBody = 0, nDecayParticles = 0;
+                for (int j = first; j < last; j++) {
+                    const int index = buffer.GetIndex()[j];
+                    if (Particle::GetNDecayChannels(index) == 0)
+                        continue;
+                    const int channel = Particle::SampleDecayChannel(index, rng->Rndm());
+                    const int nDaughters = Particle::GetNDaughters(channel);
+                    const int *daughters = Particle::GetDaughters(channel);
+
+                    const int position = nDecayParticles;
+                    Particle &mother = a.decays[position];
+                    mother.SetIndex(index);
+                    mother.SetP(buffer.GetPx()[j], buffer.GetPy()[j], buffer.GetPz()[j]);
+                    for (int d = 0; d < nDaughters; d++)
+                        a.decays[position + 1 + d].SetIndex(daughters[d]);
+                    if (nDaughters == 2) {
+                        a.mothers[nTwoBody] = position;
+                        a.dau1[nTwoBody] = position + 1;
+                        a.dau2[nTwoBody] = position + 2;
+                        nTwoBody++;
+                    }
+                    a.positions[nDecays] = position;
+                    a.parents[nDecays] = j;
+                    nDecays++;
+                    nDecayParticles += 1 + nDaughters;
+                }
+
+                // Two-body decays of the generation together, then the others one by one
+                int nFailed = Particle::Decay2Body(a.decays.data(), a.mothers.data(), a.dau1.data(), a.dau2.data(), nTwoBody, rng);
+                for (int k = 0; k < nDecays; k++) {
+                    const int position = a.positions[k];
+                    const int nDaughters = (k + 1 < nDecays ? a.positions[k + 1] : nDecayParticles) - position - 1;
+                    if (nDaughters == 3 && a.decays[position].Decay3Body(a.decays[position + 1], a.decays[position + 2], a.decays[position + 3], rng) != 0)
+                        nFailed++;
+                }
+                PROFILE_COUNT(Profiler::kDecayedResonances, nDecays);
+                PROFILE_COUNT(Profiler::kFailedDecays, nFailed);
+
+                // Append the daughters to the buffer, next to each other, linked to their mother
+                for (int k = 0; k < nDecays; k++) {
+                    const int end = k + 1 < nDecays ? a.positions[k + 1] : nDecayParticles;
+                    for (int d = a.positions[k] + 1; d < end; d++) {
+                        const Particle &daughter = a.decays[d];
+                        const int added = buffer.Add(daughter.GetPx(), daughter.GetPy(), daughter.GetPz(), daughter.GetIndex(), a.parents[k]);
+                        if (event.weighted) {
+                            a.ReserveWeights(added + 1);
+                            a.weights[added] = a.weights[a.parents[k]];
+                        }
+                    }
+                }
+            }
+            PROFILE_COUNT(Profiler::kParticles, buffer.GetSize());
+        }
+};
+
+// Detector resolution: the momentum of every particle of the buffer is scaled by a Gaussian
+// factor of mean 1 and sigma gConfig.momentumResolution, keeping its direction and mass.
+// The pairs and the stored events see the smeared momenta
+class SmearingStage : public EventStage {
+    public:
+        void Process(PipelineEvent &event) override {
+            EventBuffer &buffer = event.arena->buffer;
+            const int n = buffer.GetSize();
+            if ((int) fFactors.size() < n)
+                fFactors.resize(max<size_t>(n, 2 * fFactors.size()));
+            event.rng->Gaussians(fFactors.data(), n, 1, gConfig.momentumResolution);
+            for (int j = 0; j < n; j++) {
+                const double factor = fFactors[j];
+                buffer.Set(j, factor * buffer.GetPx()[j], factor * buffer.GetPy()[j], factor * buffer.GetPz()[j], buffer.GetIndex()[j], buffer.GetParent()[j]);
+            }
+            event.transformed = true;
+        }
+
+    private:
+        vector<double> fFactors;
+};
+
+// Invariant masses of the pairs of the event and of the mixed pairs (see PairAnalysis)
+class PairStage : public EventStage {
+    public:
+        PairStage(const PairTable &pairTable, int capacity) : fPairAnalysis(pairTable, capacity, gConfig.mixingDepth) {}
+
+        void Process(PipelineEvent &event) override {
+            fPairAnalysis.Fill(*event.h, event.arena->buffer, event.GetWeights());
+        }
+
+    private:
+        PairAnalysis fPairAnalysis;
+};
+
+// Generation histograms: species, angles and momenta of the primaries and their energies,
+// and species of all the particles of the event (particle types: bin = species id + 1).
+// Kinematics are those of the buffer, after any transform: events whose momenta were
+// transformed are filled from the buffer components as the events file is read back (see
+// EventStoreReader), the others from the values generated, which they are equal to
+class FillStage : public EventStage {
+    public:
+        void Process(PipelineEvent &event) override {
+            PROFILE_SCOPE(kFills);
+            Histograms &h = *event.h;
+            const EventArena &a = *event.arena;
+            if (event.transformed) {
+                EventStoreReader::FillPrimaryHistograms(h, a.buffer, event.GetWeights());
+                return;
+            }
+            const int nPrimaries = event.nPrimaries;
+            const int nParticles = a.buffer.GetSize();
+            const int *species = a.species.data();
+            const int *index = a.buffer.GetIndex();
+            if (event.weighted) {
+                const double *weights = a.weights.data();
+                for (int j = 0; j < nPrimaries; j++)
+                    h.particleTypesH->FillBin(species[j] + 1, weights[j]);
+                for (int j = 0; j < nParticles; j++)
+                    h.finalParticleTypesH->FillBin(index[j] + 1, weights[j]);
+                h.azimutAngleH->FillN(nPrimaries, a.phis.data(), weights);
+                h.polarAngleH->FillN(nPrimaries, a.thetas.data(), weights);
+                h.momentumH->FillN(nPrimaries, a.momenta.data(), weights);
+                h.transverseMomentumH->FillN(nPrimaries, a.transverseMomenta.data(), weights);
+                h.particleEnergyH->FillN(nPrimaries, a.buffer.GetE(), weights);
+            } else {
+                for (int j = 0; j < nPrimaries; j++)
+                    h.particleTypesH->FillBin(species[j] + 1);
+                for (int j = 0; j < nParticles; j++)
+                    h.finalParticleTypesH->FillBin(index[j] + 1);
+                h.azimutAngleH->FillN(nPrimaries, a.phis.data());
+                h.polarAngleH->FillN(nPrimaries, a.thetas.data());
+                h.momentumH->FillN(nPrimaries, a.momenta.data());
+                h.transverseMomentumH->FillN(nPrimaries, a.transverseMomenta.data());
+                h.particleEnergyH->FillN(nPrimaries, a.buffer.GetE());
+            }
+        }
+};
+
+// Appends the event to the block of the events file being written, if any
+class StoreStage : public EventStage {
+    public:
+        void Process(PipelineEvent &event) override {
+            if (event.block)
+                event.block->AddEvent(event.arena->buffer);
+        }
+};
+
+static EventStage *NewGenerationStage(const PairTable &, int) {
+    return new GenerationStage();
+}
+
+static EventStage *NewDecayStage(const PairTable &, int) {
+    return new DecayStage();
+}
+
+static EventStage *NewSmearingStage(const PairTable &, int) {
+    return gConfig.momentumResolution > 0 ? new SmearingStage() : 0;
+}
+
+static EventStage *NewPairStage(const PairTable &pairTable, int capacity) {
+    return new PairStage(pairTable, capacity);
+}
+
+static EventStage *NewFillStage(const PairTable &, int) {
+    return new FillStage();
+}
+
+static EventStage *NewStoreStage(const PairTable &, int) {
+    return new StoreStage();
+}
+
+// Registered stages, starting with the built-in ones
+vector<EventPipeline::Registration> &EventPipeline::Registry() {
+    static vector<Registration> registry = {
+        {kGenerate, "generation", NewGenerationStage},
+        {kDecay, "decays", NewDecayStage},
+        {kTransform, "smearing", NewSmearingStage},
+        {kPairs, "pairs", NewPairStage},
+        {kFill, "fills", NewFillStage},
+        {kFill, "store", NewStoreStage}
+    };
+    return registry;
+}
+
+// Add a stage to the pipelines built from now on, after those already registered in its
+// phase. Not thread safe: stages are registered at startup
+void EventPipeline::Register(int phase, const string name, EventStageFactory factory) {
+    Registry().push_back({phase, name, factory});
+}
+
+// Instances of the registered stages, in phase order, for events of up to capacity
+// particles at first; stages disabled by gConfig are left out
+EventPipeline::EventPipeline(const PairTable &pairTable, int capacity) {
+    vector<Registration> registry = Registry();
+    stable_sort(registry.begin(), registry.end(), [](const Registration &a, const Registration &b) { return a.phase < b.phase; });
+    for (size_t i = 0; i < registry.size(); i++) {
+        EventStage *stage = registry[i].factory(pairTable, capacity);
+        if (stage)
+            fStages.push_back(stage);
+    }
+}
+
+EventPipeline::~EventPipeline() {
+    for (size_t i = 0; i < fStages.size(); i++)
+        delete fStages[i];
+}
@@ -0,0 +1,81 @@
+#include "EventArena.h"
+#include "EventStore.h"
+#include "Histograms.h"
+#include "PairTable.h"
+#include "PhiloxRandom.h"
+
+#include <string>
+#include <vector>
+
+#ifndef EVENT_PIPELINE_H
+#define EVENT_PIPELINE_H
+
+using namespace std;
+
+// Event going through the stages of an EventPipeline: its number, whose stream rng draws
+// from, the arena of the thread it is built in, the histograms it is filled in and the block
+// it is appended to, if any. The generation stage sets the number of primaries and whether
+// the particles carry importance weights (see SpeciesWeights), transform stages that change
+// the momenta in the buffer set transformed
+struct PipelineEvent {
+    Long64_t number;
+    PhiloxRandom *rng;
+    EventArena *arena;
+    Histograms *h;
+    EventBlock *block;
+    int nPrimaries;
+    bool weighted;
+    bool transformed;
+
+    const double *GetWeights() const { return weighted ? arena->weights.data() : 0; }
+};
+
+// Step of the processing of an event, working in place on its arena
+class EventStage {
+    public:
+        virtual ~EventStage() {}
+        virtual void Process(PipelineEvent &event) = 0;
+};
+
+// Creates the stage of a thread, or returns 0 if the stage is disabled by gConfig
+typedef EventStage *(*EventStageFactory)(const PairTable &pairTable, int capacity);
+
+// Processing of the events of a thread as a sequence of stages, grouped in phases: the
+// primaries are generated, the resonances decayed, the particles transformed (e.g. smeared by
+// the detector resolution, see Config), the pairs analyzed, then the histograms filled and the
+// event stored. Stages are registered by phase at startup, before any pipeline is built; the
+// built-in ones come first in their phase, and each pipeline creates its own instances. The
+// stages are fused: each event goes through all of them while it is in the arena, so a new
+// stage adds work but no pass over the events, and the histograms of a chunk are filled by
+// one sweep of its events
+class EventPipeline {
+    public:
+        enum Phase { kGenerate, kDecay, kTransform, kPairs, kFill, fNPhases };
+
+        EventPipeline(const PairTable &pairTable, int capacity);
+        ~EventPipeline();
+        void Process(PipelineEvent &event);
+
+        static void Register(int phase, const string name, EventStageFactory factory);
+
+    private:
+        vector<EventStage *> fStages;
+
+        struct Registration {
+            int phase;
+            string name;
+            EventStageFactory factory;
+        };
+        static vector<Registration> &Registry();
+
+        EventPipeline(const EventPipeline &) = delete;
+        EventPipeline &operator=(const EventPipeline &) = delete;
+};
+
+// Runs every stage of the event, in phase order
+inline void EventPipeline::Process(PipelineEvent &event) {
+    for (size_t i = 0; i < fStages.size(); i++)
+        fStages[i]->Process(event);
+}
+
+#endif
@@ -0,0 +1,363 @@
+#include "EventStore.h"
+
+#include "Config.h"
+#include "GenerateParticles.h"
+#include "PairAnalysis.h"
+#include "Parameters.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char kMagic[8] = {'K', 'S', 'E', 'V', 'T', 'S', '0', '3'};
+
+static size_t Padded(size_t size) {
+    return (size + 7) / 8 * 8;
+}
+
+void EventBlock::AddEvent(const EventBuffer &buffer) {
+    const int start = fEventStart.back();
+    const int n = buffer.GetSize();
+    for (int i = 0; i < n; i++) {
+        fPx.push_back(buffer.GetPx()[i]);
+        fPy.push_back(buffer.GetPy()[i]);
+        fPz.push_back(buffer.GetPz()[i]);
+        fSpecies.push_back(buffer.GetIndex()[i]);
+        fParent.push_back(buffer.GetParent()[i]);
+    }
+    fEventStart.push_back(start + n);
+}
+
+void EventBlock::Clear() {
+    fEventStart.assign(1, 0);
+    fPx.clear();
+    fPy.clear();
+    fPz.clear();
+    fSpecies.clear();
+    fParent.clear();
+}
+
+int EventBlock::GetNEvents() const {
+    return fEventStart.size() - 1;
+}
+
+int EventBlock::GetNParticles() const {
+    return fEventStart.back();
+}
+
+EventStoreWriter::EventStoreWriter(const string fileName) : fNSpecies(Particle::GetNParticleTypes()), fSpeciesWeights(SpeciesWeights()) {
+    fFile = fopen(fileName.c_str(), "wb");
+    if (!fFile) {
+        std::cout << "Cannot open event file " << fileName << " for writing" << std::endl;
+        return;
+    }
+    fwrite(kMagic, 1, sizeof(kMagic), fFile);
+}
+
+EventStoreWriter::~EventStoreWriter() {
+    Close();
+}
+
+bool EventStoreWriter::IsOpen() const {
+    return fFile != 0;
+}
+
+void EventStoreWriter::WriteColumn(const void *data, size_t size) {
+    static const char padding[8] = {0};
+    fwrite(data, 1, size, fFile);
+    fwrite(padding, 1, Padded(size) - size, fFile);
+}
+
+void EventStoreWriter::WriteBlock(int chunk, const EventBlock &block) {
+    lock_guard<mutex> lock(fMutex);
+    if (!fFile)
+        return;
+
+    fIndex.push_back(make_pair(int32_t(chunk), int64_t(ftell(fFile))));
+    const int32_t counts[2] = {block.GetNEvents(), block.GetNParticles()};
+    const size_t n = block.GetNParticles();
+    WriteColumn(counts, sizeof(counts));
+    WriteColumn(block.fEventStart.data(), block.fEventStart.size() * sizeof(int32_t));
+    WriteColumn(block.fPx.data(), n * sizeof(double));
+    WriteColumn(block.fPy.data(), n * sizeof(double));
+    WriteColumn(block.fPz.data(), n * sizeof(double));
+    WriteColumn(block.fSpecies.data(), n * sizeof(int32_t));
+    WriteColumn(block.fParent.data(), n * sizeof(int32_t));
+}
+
+void EventStoreWriter::Close() {
+    lock_guard<mutex> lock(fMutex);
+    if (!fFile)
+        return;
+
+    sort(fIndex.begin(), fIndex.end());
+    const int64_t indexOffset = ftell(fFile);
+    const int32_t nBlocks = fIndex.size();
+    fwrite(&nBlocks, sizeof(nBlocks), 1, fFile);
+    for (const pair<int32_t, int64_t> &entry : fIndex) {
+        fwrite(&entry.first, sizeof(entry.first), 1, fFile);
+        fwrite(&entry.second, sizeof(entry.second), 1, fFile);
+    }
+    const int32_t species[2] = {fNSpecies, !fSpeciesWeights.empty()};
+    fwrite(species, sizeof(int32_t), 2, fFile);
+    fwrite(fSpeciesWeights.data(), sizeof(double), fSpeciesWeights.size(), fFile);
+    fwrite(&indexOffset, sizeof(indexOffset), 1, fFile);
+    fclose(fFile);
+    fFile = 0;
+}
+
+EventStoreReader::EventStoreReader(const string fileName) : fData(0), fSize(0) {
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t) (sizeof(kMagic) + sizeof(int64_t))) {
+        std::cout << "Cannot open event file " << fileName << std::endl;
+        if (fd >= 0)
+            close(fd);
+        return;
+    }
+
+    void *data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        if (data != MAP_FAILED && memcmp(data, kMagic, sizeof(kMagic) - 1) == 0)
+            std::cout << "File " << fileName << " is an event file of an older format, regenerate it" << std::endl;
+        else
+            std::cout << "File " << fileName << " is not a valid event file" << std::endl;
+        if (data != MAP_FAILED)
+            munmap(data, st.st_size);
+        return;
+    }
+    fData = static_cast<const char *>(data);
+    fSize = st.st_size;
+
+    // Read the block index from the end of the file. A file whose writer was interrupted
+    // has no index, so every offset and size is checked against the file before use
+    int64_t indexOffset;
+    int32_t nBlocks = -1;
+    memcpy(&indexOffset, fData + fSize - sizeof(int64_t), sizeof(int64_t));
+    const bool hasIndex = indexOffset >= (int64_t) sizeof(kMagic) && (uint64_t) indexOffset + sizeof(int32_t) + sizeof(int64_t) <= fSize;
+    if (hasIndex)
+        memcpy(&nBlocks, fData + indexOffset, sizeof(int32_t));
+    const uint64_t speciesOffset = (uint64_t) indexOffset + sizeof(int32_t) + (uint64_t) max(nBlocks, 0) * (sizeof(int32_t) + sizeof(int64_t));
+    bool valid = nBlocks >= 0 && speciesOffset + 2 * sizeof(int32_t) + sizeof(int64_t) <= fSize;
+
+    // Size of the catalog of the run, which must be the current one, and weights of its
+    // species if the run was weighted, ending the index
+    int32_t species[2] = {-1, -1};
+    if (valid)
+        memcpy(species, fData + speciesOffset, 2 * sizeof(int32_t));
+    const int32_t nSpecies = species[0], nWeights = species[1] == 1 ? nSpecies : 0;
+    valid = valid && nSpecies >= 0 && (species[1] == 0 || species[1] == 1) &&
+            speciesOffset + 2 * sizeof(int32_t) + (uint64_t) nWeights * sizeof(double) + sizeof(int64_t) == fSize;
+    const bool sameCatalog = nSpecies == Particle::GetNParticleTypes();
+    const char *entry = fData + indexOffset + sizeof(int32_t);
+    for (int b = 0; valid && sameCatalog && b < nBlocks; b++) {
+        int64_t offset;
+        memcpy(&offset, entry + sizeof(int32_t), sizeof(int64_t));
+        valid = IsValidBlock(offset, indexOffset);
+        fBlockOffsets.push_back(offset);
+        entry += sizeof(int32_t) + sizeof(int64_t);
+    }
+    if (!valid)
+        std::cout << "File " << fileName << " is not a valid event file" << std::endl;
+    else if (!sameCatalog) {
+        std::cout << "File " << fileName << " was generated with a catalog of " << nSpecies << " particle types, not " << Particle::GetNParticleTypes() << std::endl;
+        valid = false;
+    } else {
+        fSpeciesWeights.resize(nWeights);
+        memcpy(fSpeciesWeights.data(), fData + speciesOffset + 2 * sizeof(int32_t), nWeights * sizeof(double));
+    }
+    if (!valid) {
+        munmap(data, fSize);
+        fData = 0;
+        fSize = 0;
+        fBlockOffsets.clear();
+        fSpeciesWeights.clear();
+    }
+}
+
+// Whether a block at offset, 8-byte aligned, has all its columns before end, consistent
+// event boundaries, species of the current catalog and parents before their daughters
+bool EventStoreReader::IsValidBlock(int64_t offset, int64_t end) const {
+    if (offset < (int64_t) sizeof(kMagic) || offset % 8 != 0 || offset + (int64_t) Padded(2 * sizeof(int32_t)) > end)
+        return false;
+    const int32_t *counts = reinterpret_cast<const int32_t *>(fData + offset);
+    const int64_t nEvents = counts[0], n = counts[1];
+    if (nEvents < 0 || n < 0)
+        return false;
+    const uint64_t size = Padded(2 * sizeof(int32_t)) + Padded((nEvents + 1) * sizeof(int32_t)) + 3 * Padded(n * sizeof(double)) + 2 * Padded(n * sizeof(int32_t));
+    if (size > (uint64_t) (end - offset))
+        return false;
+    const int32_t *eventStart = counts + Padded(2 * sizeof(int32_t)) / sizeof(int32_t);
+    if (eventStart[0] != 0 || eventStart[nEvents] != n)
+        return false;
+    for (int64_t e = 0; e < nEvents; e++) {
+        if (eventStart[e + 1] < eventStart[e])
+            return false;
+    }
+
+    const int32_t *species = reinterpret_cast<const int32_t *>(reinterpret_cast<const char *>(eventStart) + Padded((nEvents + 1) * sizeof(int32_t)) + 3 * Padded(n * sizeof(double)));
+    const int32_t *parent = reinterpret_cast<const int32_t *>(reinterpret_cast<const char *>(species) + Padded(n * sizeof(int32_t)));
+    const int nTypes = Particle::GetNParticleTypes();
+    for (int64_t e = 0; e < nEvents; e++) {
+        for (int32_t i = eventStart[e]; i < eventStart[e + 1]; i++) {
+            if (species[i] < 0 || species[i] >= nTypes || parent[i] < -1 || parent[i] >= i - eventStart[e])
+                return false;
+        }
+    }
+    return true;
+}
+
+EventStoreReader::~EventStoreReader() {
+    if (fData)
+        munmap(const_cast<char *>(fData), fSize);
+}
+
+bool EventStoreReader::IsOpen() const {
+    return fData != 0;
+}
+
+int EventStoreReader::GetNBlocks() const {
+    return fBlockOffsets.size();
+}
+
+int EventStoreReader::GetNEvents() const {
+    int nEvents = 0;
+    for (int64_t offset : fBlockOffsets)
+        nEvents += reinterpret_cast<const int32_t *>(fData + offset)[0];
+    return nEvents;
+}
+
+// Fill the histograms selected by mask (bit i set for histogram id i) from the stored events.
+// Blocks are read by nThreads workers into separate histograms, merged in block order
+void EventStoreReader::FillHistograms(Histograms &h, const PairTable &pairTable, unsigned int mask, int nThreads) const {
+    const int nBlocks = fBlockOffsets.size();
+    vector<Histograms *> blockHistograms(nBlocks);
+    for (int b = 0; b < nBlocks; b++)
+        blockHistograms[b] = new Histograms();
+
+    atomic<int> nextBlock(0);
+    auto worker = [&]() {
+        for (int b = nextBlock++; b < nBlocks; b = nextBlock++)
+            FillBlock(b, *blockHistograms[b], pairTable, mask);
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(worker));
+    worker();
+    for (thread &t : threads)
+        t.join();
+
+    for (int b = 0; b < nBlocks; b++) {
+        for (int id = 0; id < Histograms::fNHistograms; id++)
+            if (mask & (1u << id))
+                h.Get(id)->Add(*blockHistograms[b]->Get(id));
+        delete blockHistograms[b];
+    }
+}
+
+void EventStoreReader::FillBlock(int b, Histograms &h, const PairTable &pairTable, unsigned int mask) const {
+    const unsigned int pairMask = fAllHistograms & ~((1u << Histograms::kInvMass) - 1);
+
+    // Columns of the block, all 8-byte aligned
+    const char *data = fData + fBlockOffsets[b];
+    const int32_t *counts = reinterpret_cast<const int32_t *>(data);
+    const int nEvents = counts[0];
+    const size_t n = counts[1];
+    data += Padded(2 * sizeof(int32_t));
+    const int32_t *eventStart = reinterpret_cast<const int32_t *>(data);
+    data += Padded((nEvents + 1) * sizeof(int32_t));
+    const double *px = reinterpret_cast<const double *>(data);
+    data += Padded(n * sizeof(double));
+    const double *py = reinterpret_cast<const double *>(data);
+    data += Padded(n * sizeof(double));
+    const double *pz = reinterpret_cast<const double *>(data);
+    data += Padded(n * sizeof(double));
+    const int32_t *species = reinterpret_cast<const int32_t *>(data);
+    data += Padded(n * sizeof(int32_t));
+    const int32_t *parent = reinterpret_cast<const int32_t *>(data);
+
+    // Buffers are sized for the largest event of the block
+    int capacity = 1;
+    for (int e = 0; e < nEvents; e++)
+        capacity = max(capacity, eventStart[e + 1] - eventStart[e]);
+    EventBuffer buffer(capacity);
+    PairAnalysis pairAnalysis(pairTable, capacity, gConfig.mixingDepth);
+
+    // Events of a weighted run are weighted again from the species of their primaries, with
+    // the weights saved in the file
+    const vector<double> &speciesWeights = fSpeciesWeights;
+    vector<double> weights(speciesWeights.empty() ? 0 : capacity);
+
+    for (int e = 0; e < nEvents; e++) {
+        const int start = eventStart[e];
+        const int size = eventStart[e + 1] - start;
+
+        buffer.SetSize(size);
+        for (int i = 0; i < size; i++)
+            buffer.Set(i, px[start + i], py[start + i], pz[start + i], species[start + i], parent[start + i]);
+
+        if (!weights.empty()) {
+            for (int i = 0; i < size; i++)
+                weights[i] = parent[start + i] < 0 ? speciesWeights[species[start + i]] : weights[parent[start + i]];
+        }
+
+        FillPrimaryHistograms(h, buffer, weights.empty() ? 0 : weights.data(), mask);
+        if (mask & pairMask)
+            pairAnalysis.Fill(h, buffer, weights.empty() ? 0 : weights.data());
+    }
+}
+
+// Generation histograms, with angles and momenta recomputed from the components in the
+// buffer, weighted with the importance weights of the particles if given. Also used by the
+// generation of events whose momenta are transformed, so that they are rebuilt identically
+void EventStoreReader::FillPrimaryHistograms(Histograms &h, const EventBuffer &buffer, const double *weights, unsigned int mask) {
+    const int *indices = buffer.GetIndex();
+    const int *parents = buffer.GetParent();
+
+    for (int i = 0; i < buffer.GetSize(); i++) {
+        auto fill = [&](int id, double x) {
+            if (!(mask & (1u << id)))
+                return;
+            if (weights)
+                h.Get(id)->Fill(x, weights[i]);
+            else
+                h.Get(id)->Fill(x);
+        };
+        auto fillBin = [&](int id, int bin) {
+            if (!(mask & (1u << id)))
+                return;
+            if (weights)
+                h.Get(id)->FillBin(bin, weights[i]);
+            else
+                h.Get(id)->FillBin(bin);
+        };
+
+        fillBin(Histograms::kFinalParticleTypes, indices[i] + 1);
+        if (parents[i] >= 0)
+            continue;
+
+        const double px = buffer.GetPx()[i];
+        const double py = buffer.GetPy()[i];
+        const double pz = buffer.GetPz()[i];
+        const double pt = sqrt(px * px + py * py);
+        const double P = sqrt(pt * pt + pz * pz);
+        const double phi = atan2(py, px);
+
+        fillBin(Histograms::kParticleTypes, indices[i] + 1);
+        fill(Histograms::kAzimutAngle, phi < 0 ? phi + 2 * M_PI : phi);
+        fill(Histograms::kPolarAngle, P > 0 ? acos(pz / P) : 0);
+        fill(Histograms::kMomentum, P);
+        fill(Histograms::kTransverseMomentum, pt);
+        fill(Histograms::kParticleEnergy, buffer.GetE()[i]);
+    }
+}
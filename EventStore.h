@@ -0,0 +1,94 @@
+#include "EventBuffer.h"
+#include "Histograms.h"
+#include "PairTable.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef EVENT_STORE_H
+#define EVENT_STORE_H
+
+using namespace std;
+
+// Event-level output of the generator, in a columnar binary file. The file is a sequence
+// of blocks, one per generation chunk, followed by an index of the blocks in chunk order:
+//
+//     "KSEVTS03"
+//     block:  int32 nEvents, int32 nParticles, int32 eventStart[nEvents + 1],
+//             double px[nParticles], double py[nParticles], double pz[nParticles],
+//             int32 species[nParticles], int32 parent[nParticles]
+//     index:  int32 nBlocks, { int32 chunk, int64 offset } [nBlocks],
+//             int32 nSpecies, int32 weighted, double speciesWeights[weighted ? nSpecies : 0]
+//     int64 index offset
+//
+// nSpecies is the size of the particle catalog of the run, which readers must have loaded,
+// and speciesWeights the importance weights of the species of its primaries (see
+// SpeciesWeights), none for unweighted runs, so that histograms are rebuilt with the weights
+// the events were generated with whatever the biases of the reading run.
+// Columns are padded to 8 bytes. Species are ids in the catalog, parents positions within the
+// event before the particle, -1 for primaries. Files of older formats are refused
+
+// Columns of the events of one chunk, filled by a single worker
+class EventBlock {
+    public:
+        void AddEvent(const EventBuffer &buffer);
+        void Clear();
+        int GetNEvents() const;
+        int GetNParticles() const;
+
+    private:
+        vector<int32_t> fEventStart = vector<int32_t>(1, 0);
+        vector<double> fPx, fPy, fPz;
+        vector<int32_t> fSpecies;
+        vector<int32_t> fParent;
+
+        friend class EventStoreWriter;
+};
+
+// Thread-safe writer: blocks are appended as they are completed, the index at the end of
+// the file lists them by chunk so that readers see events in generation order
+class EventStoreWriter {
+    public:
+        EventStoreWriter(const string fileName);
+        ~EventStoreWriter();
+        bool IsOpen() const;
+        void WriteBlock(int chunk, const EventBlock &block);
+        void Close();
+
+    private:
+        FILE *fFile;
+        mutex fMutex;
+        vector<pair<int32_t, int64_t>> fIndex;
+        int fNSpecies;
+        vector<double> fSpeciesWeights;
+
+        void WriteColumn(const void *data, size_t size);
+};
+
+// Memory-mapped reader, rebuilding histograms without regenerating the events
+class EventStoreReader {
+    public:
+        EventStoreReader(const string fileName);
+        ~EventStoreReader();
+        bool IsOpen() const;
+        int GetNBlocks() const;
+        int GetNEvents() const;
+        void FillHistograms(Histograms &h, const PairTable &pairTable, unsigned int mask = fAllHistograms, int nThreads = 1) const;
+        static void FillPrimaryHistograms(Histograms &h, const EventBuffer &buffer, const double *weights, unsigned int mask = fAllHistograms);
+
+        static const unsigned int fAllHistograms = (1u << Histograms::fNHistograms) - 1;
+
+    private:
+        const char *fData;
+        size_t fSize;
+        vector<int64_t> fBlockOffsets;
+        vector<double> fSpeciesWeights;
+
+        bool IsValidBlock(int64_t offset, int64_t end) const;
+        void FillBlock(int b, Histograms &h, const PairTable &pairTable, unsigned int mask) const;
+};
+
+#endif
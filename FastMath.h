@@ -0,0 +1,37 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+// Sine and cosine of x >= 0 together, with the Cephes polynomials (about 1e-16 relative
+// error for arguments of a few turns). Unlike libm calls, the body has no calls and no
+// branches, so loops using it are vectorized by the compiler
+inline void SinCos(double x, double &s, double &c) {
+    // Extended precision pi/4
+    const double DP1 = 7.85398125648498535156E-1;
+    const double DP2 = 3.77489470793079817668E-8;
+    const double DP3 = 2.69515142907905952645E-15;
+    const double FOUR_OVER_PI = 1.27323954473516268615;
+
+    // Octant of x, rounded up to the even one, and x reduced to [-pi/4, pi/4]
+    int j = (int) (x * FOUR_OVER_PI);
+    j += j & 1;
+    const double y = j;
+    const double z = ((x - y * DP1) - y * DP2) - y * DP3;
+    const double zz = z * z;
+
+    const double sinPoly = z + z * zz * (((((1.58962301576546568060E-10 * zz - 2.50507477628578072866E-8) * zz +
+                           2.75573136213857245213E-6) * zz - 1.98412698295895385996E-4) * zz +
+                           8.33333333332211858878E-3) * zz - 1.66666666666666307295E-1);
+    const double cosPoly = 1.0 - 0.5 * zz + zz * zz * (((((-1.13585365213876817300E-11 * zz + 2.08757008419747316778E-9) * zz -
+                           2.75573141792967388112E-7) * zz + 2.48015872888517045348E-5) * zz -
+                           1.38888888888730564116E-3) * zz + 4.16666666666665929218E-2);
+
+    // Quadrant 0: (sin, cos), 1: (cos, -sin), 2: (-sin, -cos), 3: (-cos, sin)
+    const int quadrant = (j >> 1) & 3;
+    const bool swap = quadrant & 1;
+    const double sinValue = swap ? cosPoly : sinPoly;
+    const double cosValue = swap ? sinPoly : cosPoly;
+    s = quadrant >= 2 ? -sinValue : sinValue;
+    c = (quadrant == 1 || quadrant == 2) ? -cosValue : cosValue;
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include "FixedHistogram.h"
+
+#include <TH1D.h>
+#include <TH1F.h>
+#include <cmath>
+
+using namespace std;
+
+FixedHistogram::FixedHistogram(const string name, const string title, int nBins, double min, double max, bool isFloat) :
+    fName(name), fTitle(title), fNBins(nBins), fMin(min), fMax(max), fFloat(isFloat), fSumw2(false), fWeighted(false) {
+    fCounts.assign(nBins + 2, 0);
+    fSumw.assign(nBins + 2, 0);
+    fSumw2Array.assign(nBins + 2, 0);
+    fEntries = fTsumw = fTsumw2 = fTsumwx = fTsumwx2 = 0;
+}
+
+// Sum of squared weights is exported to the TH1 (errors of weighted fills are always kept)
+void FixedHistogram::Sumw2() {
+    fSumw2 = true;
+}
+
+void FixedHistogram::Fill(double x, double w) {
+    const int bin = FindBin(x);
+    fSumw[bin] += w;
+    fSumw2Array[bin] += w * w;
+    fWeighted = true;
+    fEntries++;
+    if (IsInRange(bin)) {
+        fTsumw += w;
+        fTsumw2 += w * w;
+        fTsumwx += w * x;
+        fTsumwx2 += w * x * x;
+    }
+}
+
+// Batched unit weight fill of n values
+void FixedHistogram::FillN(int n, const double *x) {
+    for (int i = 0; i < n; i++)
+        Fill(x[i]);
+}
+
+// Values of single precision event buffers, binned as their conversion to double
+void FixedHistogram::FillN(int n, const float *x) {
+    for (int i = 0; i < n; i++)
+        Fill(x[i]);
+}
+
+// Batched fill of n values with weights w
+void FixedHistogram::FillN(int n, const double *x, const double *w) {
+    for (int i = 0; i < n; i++)
+        Fill(x[i], w[i]);
+}
+
+void FixedHistogram::FillN(int n, const float *x, const double *w) {
+    for (int i = 0; i < n; i++)
+        Fill(x[i], w[i]);
+}
+
+void FixedHistogram::Add(const FixedHistogram &other) {
+    for (int bin = 0; bin < fNBins + 2; bin++) {
+        fCounts[bin] += other.fCounts[bin];
+        fSumw[bin] += other.fSumw[bin];
+        fSumw2Array[bin] += other.fSumw2Array[bin];
+    }
+    fWeighted = fWeighted || other.fWeighted;
+    fEntries += other.fEntries;
+    fTsumw += other.fTsumw;
+    fTsumw2 += other.fTsumw2;
+    fTsumwx += other.fTsumwx;
+    fTsumwx2 += other.fTsumwx2;
+}
+
+void FixedHistogram::Reset() {
+    fCounts.assign(fNBins + 2, 0);
+    fSumw.assign(fNBins + 2, 0);
+    fSumw2Array.assign(fNBins + 2, 0);
+    fWeighted = false;
+    fEntries = fTsumw = fTsumw2 = fTsumwx = fTsumwx2 = 0;
+}
+
+double FixedHistogram::GetBinContent(int bin) const {
+    return fCounts[bin] + fSumw[bin];
+}
+
+double FixedHistogram::GetEntries() const {
+    return fEntries;
+}
+
+int FixedHistogram::GetNBins() const {
+    return fNBins;
+}
+
+double FixedHistogram::GetMin() const {
+    return fMin;
+}
+
+double FixedHistogram::GetMax() const {
+    return fMax;
+}
+
+const string &FixedHistogram::GetName() const {
+    return fName;
+}
+
+// Create a detached TH1F or TH1D with the same binning and contents
+TH1 *FixedHistogram::ToTH1() const {
+    const Bool_t addDirectory = TH1::AddDirectoryStatus();
+    TH1::AddDirectory(kFALSE);
+    TH1 *h;
+    if (fFloat)
+        h = new TH1F(fName.c_str(), fTitle.c_str(), fNBins, fMin, fMax);
+    else
+        h = new TH1D(fName.c_str(), fTitle.c_str(), fNBins, fMin, fMax);
+    TH1::AddDirectory(addDirectory);
+
+    if (fSumw2 || fWeighted)
+        h->Sumw2();
+    Export(h);
+    return h;
+}
+
+// Copy contents, squared weights, entries and statistics into h, which must have the same binning
+void FixedHistogram::Export(TH1 *h) const {
+    for (int bin = 0; bin < fNBins + 2; bin++)
+        h->SetBinContent(bin, GetBinContent(bin));
+
+    if (h->GetSumw2N() > 0) {
+        double *sumw2 = h->GetSumw2()->fArray;
+        for (int bin = 0; bin < fNBins + 2; bin++)
+            sumw2[bin] = fCounts[bin] + fSumw2Array[bin];
+    }
+
+    double stats[4] = {fTsumw, fTsumw2, fTsumwx, fTsumwx2};
+    h->PutStats(stats);
+    h->SetEntries(fEntries);
+}
+
+// Inverse of Export: a histogram with squared weights is taken as weighted sums, whose
+// unit weight fills cannot be told apart from weighted ones, the others as unit weight counts
+void FixedHistogram::Import(const TH1 *h) {
+    Reset();
+    TH1 *source = const_cast<TH1 *>(h);
+    const double *sumw2 = h->GetSumw2N() > 0 ? source->GetSumw2()->fArray : 0;
+    fWeighted = sumw2 != 0;
+    for (int bin = 0; bin < fNBins + 2; bin++) {
+        const double content = h->GetBinContent(bin);
+        if (sumw2) {
+            fSumw[bin] = content;
+            fSumw2Array[bin] = sumw2[bin];
+        } else
+            fCounts[bin] = llround(content);
+    }
+
+    double stats[4];
+    h->GetStats(stats);
+    fTsumw = stats[0];
+    fTsumw2 = stats[1];
+    fTsumwx = stats[2];
+    fTsumwx2 = stats[3];
+    fEntries = h->GetEntries();
+}
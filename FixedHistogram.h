@@ -0,0 +1,105 @@
+#include <TH1.h>
+
+#include <string>
+#include <vector>
+
+#ifndef FIXED_HISTOGRAM_H
+#define FIXED_HISTOGRAM_H
+
+using namespace std;
+
+// Minimal histogram with uniform binning. Unit weight fills are kept in integer counters
+// and weighted fills in separate sums of weights and of squared weights; bins 0 and
+// fNBins + 1 are underflow and overflow as in ROOT. Binning and statistics follow TH1::Fill
+// exactly, so the exported TH1D/TH1F has the same contents as if it had been filled directly
+class FixedHistogram {
+    public:
+        FixedHistogram(const string name, const string title, int nBins, double min, double max, bool isFloat = false);
+        void Sumw2();
+        int FindBin(double x) const;
+        double GetBinCenter(int bin) const;
+        void Fill(double x);
+        void Fill(double x, double w);
+        void FillBin(int bin);
+        void FillBin(int bin, double w);
+        void FillN(int n, const double *x);
+        void FillN(int n, const float *x);
+        void FillN(int n, const double *x, const double *w);
+        void FillN(int n, const float *x, const double *w);
+        void Add(const FixedHistogram &other);
+        void Reset();
+        double GetBinContent(int bin) const;
+        double GetEntries() const;
+        int GetNBins() const;
+        double GetMin() const;
+        double GetMax() const;
+        const string &GetName() const;
+        TH1 *ToTH1() const;
+        void Export(TH1 *h) const;
+        void Import(const TH1 *h);
+
+    private:
+        string fName;
+        string fTitle;
+        int fNBins;
+        double fMin, fMax;
+        bool fFloat;
+        bool fSumw2;
+        bool fWeighted;
+        vector<long long> fCounts;
+        vector<double> fSumw;
+        vector<double> fSumw2Array;
+        double fEntries;
+        double fTsumw, fTsumw2, fTsumwx, fTsumwx2;
+
+        bool IsInRange(int bin) const;
+};
+
+inline int FixedHistogram::FindBin(double x) const {
+    if (x < fMin)
+        return 0;
+    if (!(x < fMax))
+        return fNBins + 1;
+    return 1 + int(fNBins * (x - fMin) / (fMax - fMin));
+}
+
+// Same arithmetic as TAxis::GetBinCenter for fixed bins
+inline double FixedHistogram::GetBinCenter(int bin) const {
+    const double width = (fMax - fMin) / double(fNBins);
+    return fMin + (bin - 1) * width + 0.5 * width;
+}
+
+inline bool FixedHistogram::IsInRange(int bin) const {
+    return bin > 0 && bin <= fNBins;
+}
+
+inline void FixedHistogram::Fill(double x) {
+    const int bin = FindBin(x);
+    fCounts[bin]++;
+    fEntries++;
+    if (IsInRange(bin)) {
+        fTsumw++;
+        fTsumw2++;
+        fTsumwx += x;
+        fTsumwx2 += x * x;
+    }
+}
+
+// Unit weight fill of a known bin, without going through the bin center coordinate
+inline void FixedHistogram::FillBin(int bin) {
+    const double x = GetBinCenter(bin);
+    fCounts[bin]++;
+    fEntries++;
+    if (IsInRange(bin)) {
+        fTsumw++;
+        fTsumw2++;
+        fTsumwx += x;
+        fTsumwx2 += x * x;
+    }
+}
+
+inline void FixedHistogram::FillBin(int bin, double w) {
+    Fill(GetBinCenter(bin), w);
+}
+
+#endif
@@ -1,186 +1,525 @@
-#include "Particle.h"
+#include "GenerateParticles.h"
 
+#include "AliasSampler.h"
+#include "AnalyzeData.h"
+#include "Config.h"
+#include "EventArena.h"
+#include "EventBuffer.h"
+#include "EventPipeline.h"
+#include "EventStore.h"
+#include "Histograms.h"
+#include "PairTable.h"
+#include "Particle.h"
 #include "Parameters.h"
 #include "ParticleType.h"
+#include "Profiler.h"
 #include "ResonanceType.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
-#include <TH1D.h>
-#include <TRandom3.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include <TCanvas.h>
+#include <TF1.h>
 #include <TFile.h>
+#include <TParameter.h>
 #include <TROOT.h>
 
-void GenerateParticles() {
-    // Initialization of particle types
-    Particle::AddParticleType("π+", 0.13957, +1);
-    Particle::AddParticleType("π-", 0.13957, -1);
-    Particle::AddParticleType("K+", 0.49367, +1);
-    Particle::AddParticleType("K-", 0.49367, -1);
-    Particle::AddParticleType("p+", 0.93827, +1);
-    Particle::AddParticleType("p-", 0.93827, -1);
-    Particle::AddParticleType("K*", 0.89166, 0, 0.050);
-
-    
-    // Save histograms in root file
-    TFile *file = new TFile("histograms.root", "RECREATE");
-
-    // Histograms definitions
-    TH1F *particleTypesH = new TH1F("particleTypesH", "Particle Types", N_PARTICLE_TYPES, 0, N_PARTICLE_TYPES);
-    TH1F *finalParticleTypesH = new TH1F("finalParticleTypesH", "Final Particle Types", N_PARTICLE_TYPES, 0, N_PARTICLE_TYPES);
-    TH1D *azimutAngleH = new TH1D("azimutAngleH", "Azimut Angle", N_BINS, 0, 2 * M_PI);
-    TH1D *polarAngleH = new TH1D("polarAngleH", "Polar Angle", N_BINS, 0, M_PI);
-    TH1D *momentumH = new TH1D("momentumH", "Momentum", N_BINS, 0, MAX_MOMENTUM);
-    TH1D *transverseMomentumH = new TH1D("transverseMomentumH", "Transverse Momentum", N_BINS, 0, MAX_MOMENTUM);
-    TH1D *particleEnergyH = new TH1D("particleEnergyH", "Particle Energy", N_BINS, 0, MAX_ENERGY);
-    TH1D *invMassH = new TH1D("invMassH", "Invariant Mass", N_BINS_INV_MASS, MIN_INVARIANT_MASS, MAX_INVARIANT_MASS);
-    TH1D *discordantInvMassH = new TH1D("discordantInvMassH", "Discordant Invariant Mass", N_BINS_INV_MASS, MIN_INVARIANT_MASS, MAX_INVARIANT_MASS);
-    TH1D *concordantInvMassH = new TH1D("concordantInvMassH", "Concordant Invariant Mass", N_BINS_INV_MASS, MIN_INVARIANT_MASS, MAX_INVARIANT_MASS);
-    TH1D *discordantPionKaonInvMassH = new TH1D("discordantPionKaonInvMassH", "Discordant Pion/Kaon Invariant Mass", N_BINS_INV_MASS, MIN_INVARIANT_MASS, MAX_INVARIANT_MASS);
-    TH1D *concordantPionKaonInvMassH = new TH1D("concordantPionKaonInvMassH", "Concordant Pion/Kaon Invariant Mass", N_BINS_INV_MASS, MIN_INVARIANT_MASS, MAX_INVARIANT_MASS);
-    TH1D *daughtersInvMassH = new TH1D("daughtersInvMassH", "Resonance Daughters Invariant Mass", N_BINS_INV_MASS, MIN_INVARIANT_MASS, MAX_INVARIANT_MASS);
-
-    invMassH->Sumw2();
-    discordantInvMassH->Sumw2();
-    concordantInvMassH->Sumw2();
-    discordantPionKaonInvMassH->Sumw2();
-    concordantPionKaonInvMassH->Sumw2();
-    daughtersInvMassH->Sumw2();
-
+// Simulate nEvents events, numbered from firstEvent, and fill the given histograms.
+// Event e draws its random numbers from stream e of rng. If block is given, the events
+// are also appended to it. Events are built in the given arena, reused across calls by
+// the same thread, or in a local one, and go one at a time through the stages of an
+// EventPipeline. With biases in gConfig, species are drawn from SamplingProbabilities and
+// every fill is weighted (see SpeciesWeights)
+void GenerateEvents(Histograms &h, const PairTable &pairTable, PhiloxRandom *rng, Long64_t firstEvent, int nEvents, EventBlock *block, EventArena *arena) {
     // Variable definitions
-    Particle particles[N_PARTICLE_TYPES + MAX_PRODUCTS];
-    double phi, theta, P, rndm;
-    double Px, Py, Pz;
-    double invMass;
-
-    int nDecayedParticles;  // Counter of decayed particles
-
-    // Iterations
-    for (int i = 0; i < N_ITERATIONS; i++) {
-
-        // Reset decayed particles counter from previous iterations
-        nDecayedParticles = 0;
-
-        // Fill particles array
-        for (int j = 0; j < N_PARTICLES_PER_ITERATION; j++) {
-
-            // Random generation of momentum
-            phi = gRandom->Uniform(0, 2*M_PI);
-            theta = gRandom->Uniform(0, M_PI);
-            P = gRandom->Exp(AVG_P);
-
-            Px = P * sin(theta) * cos(phi);
-            Py = P * sin(theta) * sin(phi);
-            Pz = P * cos(theta);
-            particles[j].SetP(Px, Py, Pz);
-
-            // Random generate particle type and fill correspondent histogram
-            rndm = gRandom->Rndm();
-            if (rndm < PION_PLUS_CUMULATIVE) {
-                particles[j].SetIndex("π+");
-                particleTypesH->Fill(particleTypesH->GetBinCenter(PION_PLUS_BIN));
-                finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(PION_PLUS_BIN));
-            } else if (rndm < PION_MINUS_CUMULATIVE) {
-                particles[j].SetIndex("π-");
-                particleTypesH->Fill(particleTypesH->GetBinCenter(PION_MINUS_BIN));
-                finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(PION_MINUS_BIN));
-            } else if (rndm < KAON_PLUS_CUMULATIVE) {
-                particles[j].SetIndex("K+");
-                particleTypesH->Fill(particleTypesH->GetBinCenter(KAON_PLUS_BIN));
-                finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(KAON_PLUS_BIN));
-            } else if (rndm < KAON_MINUS_CUMULATIVE) {
-                particles[j].SetIndex("K-");
-                particleTypesH->Fill(particleTypesH->GetBinCenter(KAON_MINUS_BIN));
-                finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(KAON_MINUS_BIN));
-            } else if (rndm < PROTON_PLUS_CUMULATIVE) {
-                particles[j].SetIndex("p+");
-                particleTypesH->Fill(particleTypesH->GetBinCenter(PROTON_PLUS_BIN));
-                finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(PROTON_PLUS_BIN));
-            } else if (rndm < PROTON_MINUS_CUMULATIVE) {
-                particles[j].SetIndex("p-");
-                particleTypesH->Fill(particleTypesH->GetBinCenter(PROTON_MINUS_BIN));
-                finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(PROTON_MINUS_BIN));
-            } else {
-                particles[j].SetIndex("K*");
-                particleTypesH->Fill(particleTypesH->GetBinCenter(KAON_STAR_BIN));
-                finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(KAON_STAR_BIN));
-
-                // Decayment of K* in random pair (π+, K-) or (π-, K+)
-                rndm = gRandom->Rndm();
-                if (rndm < 0.5) {
-                    particles[N_PARTICLES_PER_ITERATION + 2 * nDecayedParticles].SetIndex("π+");
-                    particles[N_PARTICLES_PER_ITERATION + 2 * nDecayedParticles + 1].SetIndex("K-");
-                    finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(PION_PLUS_BIN));
-                    finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(KAON_MINUS_BIN));
-                } else {
-                    particles[N_PARTICLES_PER_ITERATION + 2 * nDecayedParticles].SetIndex("π-");
-                    particles[N_PARTICLES_PER_ITERATION + 2 * nDecayedParticles + 1].SetIndex("K+");
-                    finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(PION_MINUS_BIN));
-                    finalParticleTypesH->Fill(finalParticleTypesH->GetBinCenter(KAON_PLUS_BIN));
-                }
-                particles[j].Decay2Body(particles[N_PARTICLES_PER_ITERATION + 2 * nDecayedParticles], particles[N_PARTICLES_PER_ITERATION + 2 * nDecayedParticles + 1]);
-                nDecayedParticles++;
-            }
+    EventArena *localArena = arena ? 0 : new EventArena(gConfig.nParticlesPerIteration);
+    EventArena &a = arena ? *arena : *localArena;
+    EventPipeline pipeline(pairTable, a.buffer.GetCapacity());
+    PipelineEvent event = {firstEvent, rng, &a, &h, block, 0, false, false};
+
+    for (int i = 0; i < nEvents; i++) {
+        event.number = firstEvent + i;
+        rng->SetStream(event.number);
+        pipeline.Process(event);
+    }
+    PROFILE_COUNT(Profiler::kEvents, nEvents);
+    delete localArena;
+}
 
-            // Fill generation histograms
-            azimutAngleH->Fill(phi);
-            polarAngleH->Fill(theta);
-            momentumH->Fill(P);
-            transverseMomentumH->Fill(P * sin(theta));
-            particleEnergyH->Fill(particles[j].TotEnergy());
+// Load the particle catalog from gConfig.particlesFile, with the masses and widths
+// overridden in gConfig, unless already loaded
+bool InitParticleTypes() {
+    if (Particle::GetNParticleTypes() > 0)
+        return true;
+    if (!Particle::ReadParticleTypes(gConfig.particlesFile))
+        return false;
+    for (map<string, double>::const_iterator it = gConfig.particleMasses.begin(); it != gConfig.particleMasses.end(); ++it) {
+        const int index = Particle::FindParticle(it->first);
+        if (index < 0 || !Particle::SetMassAndWidth(it->first, it->second, Particle::GetWidth(index))) {
+            std::cout << "Cannot set the mass of " << it->first << std::endl;
+            return false;
+        }
+    }
+    for (map<string, double>::const_iterator it = gConfig.particleWidths.begin(); it != gConfig.particleWidths.end(); ++it) {
+        const int index = Particle::FindParticle(it->first);
+        if (index < 0 || !Particle::SetMassAndWidth(it->first, Particle::GetMass(index), it->second)) {
+            std::cout << "Cannot set the width of " << it->first << std::endl;
+            return false;
         }
+    }
+    for (map<string, double>::const_iterator it = gConfig.particleBiases.begin(); it != gConfig.particleBiases.end(); ++it) {
+        if (Particle::FindParticle(it->first) < 0) {
+            std::cout << "Cannot bias unknown particle type " << it->first << std::endl;
+            return false;
+        }
+    }
+
+    // The species and multiplicity distributions are sampled with alias tables, which need a positive sum
+    if (!AliasSampler(SamplingProbabilities()).IsValid()) {
+        std::cout << "Cannot sample the species of the primaries: their probabilities must have a positive sum" << std::endl;
+        return false;
+    }
+    if (gConfig.multiplicity != "fixed" && !AliasSampler(MultiplicityProbabilities()).IsValid()) {
+        std::cout << "Cannot sample the multiplicity: its probabilities must have a positive sum" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Probabilities of the species of the primaries: those of gConfig if given for every
+// particle type, the abundances of the catalog otherwise
+vector<double> SpeciesProbabilities() {
+    const int nTypes = Particle::GetNParticleTypes();
+    if (int(gConfig.probabilities.size()) == nTypes)
+        return gConfig.probabilities;
+    if (!gConfig.probabilities.empty())
+        std::cout << "Expected " << nTypes << " probabilities, got " << gConfig.probabilities.size() << ": using the catalog abundances" << std::endl;
+    vector<double> probabilities(nTypes);
+    for (int i = 0; i < nTypes; i++)
+        probabilities[i] = Particle::GetAbundance(i);
+    return probabilities;
+}
+
+// Probabilities with which the species of the primaries are drawn: those of
+// SpeciesProbabilities, each multiplied by the bias of its species in gConfig, if any
+vector<double> SamplingProbabilities() {
+    vector<double> probabilities = SpeciesProbabilities();
+    for (map<string, double>::const_iterator it = gConfig.particleBiases.begin(); it != gConfig.particleBiases.end(); ++it)
+        probabilities[Particle::FindParticle(it->first)] *= it->second;
+    return probabilities;
+}
+
+// Importance weights of the species of the primaries: the ratio of the probability of a
+// species to the one it is drawn with, so that weighted histograms have the expectations of
+// unbiased ones. Decay products carry the weight of their primary and pairs the product of
+// those of their primaries, or just one for two products of the same primary. Empty without
+// biases, for unweighted fills
+vector<double> SpeciesWeights() {
+    vector<double> weights;
+    if (gConfig.particleBiases.empty())
+        return weights;
+    const vector<double> probabilities = SpeciesProbabilities();
+    const vector<double> sampling = SamplingProbabilities();
+    double sum = 0, samplingSum = 0;
+    for (size_t i = 0; i < probabilities.size(); i++) {
+        sum += probabilities[i];
+        samplingSum += sampling[i];
+    }
+    for (size_t i = 0; i < probabilities.size(); i++)
+        weights.push_back(sampling[i] > 0 ? probabilities[i] / sum * samplingSum / sampling[i] : 0);
+    return weights;
+}
 
-        // Compute invariant masses and fill histograms
-        for (int j = 0; j < N_PARTICLES_PER_ITERATION + 2 * nDecayedParticles; j++) {
-            
-            // Alias particles[j] as p1
-            const ParticleType *p1 = particles[j].GetParticleType();
-
-            // Ignore K* particles for invariant mass histograms (charge == 0)
-            if (p1->GetCharge() != 0) {
-                
-                // Iterate over all previous particles in the array
-                for (int k = 0; k < j; k++) {
-                    
-                    // Alias particles[k] as p2
-                    const ParticleType *p2 = particles[k].GetParticleType();
-                    
-                    // Ignore K* particles
-                    if (p2->GetCharge() != 0) {
-
-                        // Compute invariant mass and fill histogram
-                        invMass = particles[j].InvMass(&particles[k]);
-                        invMassH->Fill(invMass);
-                        
-                        // Fill discordant or concordant charge histogram
-                        if (p1->GetCharge() != p2->GetCharge())
-                            discordantInvMassH->Fill(invMass);
-                        else
-                            concordantInvMassH->Fill(invMass);
-
-                        // Fill discordant or concordant pion-kaon histogram
-                        if (     (p1->GetName() == "π+" && p2->GetName() == "K-") ||
-                                 (p1->GetName() == "π-" && p2->GetName() == "K+") ||
-                                 (p1->GetName() == "K+" && p2->GetName() == "π-") ||
-                                 (p1->GetName() == "K-" && p2->GetName() == "π+"))
-                            discordantPionKaonInvMassH->Fill(invMass);
-                        else if ((p1->GetName() == "π+" && p2->GetName() == "K+") ||
-                                 (p1->GetName() == "π-" && p2->GetName() == "K-") ||
-                                 (p1->GetName() == "K+" && p2->GetName() == "π+") ||
-                                 (p1->GetName() == "K-" && p2->GetName() == "π-"))
-                            concordantPionKaonInvMassH->Fill(invMass);
-
-                    }
-                }
+// Probabilities of the numbers of primaries of an event, from 0 up, according to
+// gConfig.multiplicity: a Poisson distribution of mean gConfig.nParticlesPerIteration,
+// truncated where it becomes negligible ("poisson"), gConfig.multiplicityProbabilities
+// ("table"), or none for exactly gConfig.nParticlesPerIteration primaries ("fixed")
+vector<double> MultiplicityProbabilities() {
+    vector<double> probabilities;
+    if (gConfig.multiplicity == "poisson") {
+        const double mean = gConfig.nParticlesPerIteration;
+        const int nMax = (int) (mean + 10 * sqrt(mean) + 10);
+        for (int n = 0; n <= nMax; n++)
+            probabilities.push_back(exp(n * log(mean) - mean - lgamma(n + 1.0)));
+    } else if (gConfig.multiplicity == "table")
+        probabilities = gConfig.multiplicityProbabilities;
+    return probabilities;
+}
+
+// Save histograms and run information in a root file. The file is first written under a
+// temporary name, so that an interrupted write never replaces a valid file
+void WriteRun(const string fileName, const Histograms &histograms, const RunInfo &info) {
+    PROFILE_SCOPE(kWrite);
+    const string tmpFileName = fileName + ".tmp";
+    TFile *file = new TFile(tmpFileName.c_str(), "RECREATE");
+    histograms.Write();
+    TParameter<Long64_t>("runSeed", info.seed).Write();
+    TParameter<Long64_t>("runChunks", info.nChunks).Write();
+    TParameter<Long64_t>("runEvents", info.nEvents).Write();
+    TParameter<Long64_t>("runTargetEvents", info.nTargetEvents).Write();
+    TParameter<Long64_t>("runFirstEvent", info.firstEvent).Write();
+    TParameter<Long64_t>("runEventsPerChunk", info.nEventsPerChunk).Write();
+    file->Close();
+    delete file;
+    rename(tmpFileName.c_str(), fileName.c_str());
+}
+
+static bool ReadRun(const string fileName, Histograms &histograms, RunInfo &info) {
+    PROFILE_SCOPE(kRead);
+    TFile *file = new TFile(fileName.c_str(), "READ");
+    if (file->IsZombie()) {
+        delete file;
+        return false;
+    }
+
+    TParameter<Long64_t> *seed = (TParameter<Long64_t>*) file->Get("runSeed");
+    TParameter<Long64_t> *nChunks = (TParameter<Long64_t>*) file->Get("runChunks");
+    TParameter<Long64_t> *nEvents = (TParameter<Long64_t>*) file->Get("runEvents");
+    TParameter<Long64_t> *nTargetEvents = (TParameter<Long64_t>*) file->Get("runTargetEvents");
+    if (!seed || !nChunks || !nEvents || !nTargetEvents) {
+        std::cout << "File " << fileName << " has no run information" << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+    info.seed = seed->GetVal();
+    info.nChunks = nChunks->GetVal();
+    info.nEvents = nEvents->GetVal();
+    info.nTargetEvents = nTargetEvents->GetVal();
+
+    // Runs saved before shards have no first event
+    TParameter<Long64_t> *firstEvent = (TParameter<Long64_t>*) file->Get("runFirstEvent");
+    info.firstEvent = firstEvent ? firstEvent->GetVal() : 0;
+
+    // Runs saved before the chunk size was recorded are assumed to have the current one
+    TParameter<Long64_t> *nEventsPerChunk = (TParameter<Long64_t>*) file->Get("runEventsPerChunk");
+    info.nEventsPerChunk = nEventsPerChunk ? nEventsPerChunk->GetVal() : gConfig.nEventsPerChunk;
+
+    const bool ok = histograms.Read(file);
+    file->Close();
+    delete file;
+    return ok;
+}
+
+// Whether a saved run can be continued with the current parameters: its chunks must have
+// gConfig.nEventsPerChunk events, as chunk boundaries change the mixed events
+static bool HasCurrentChunks(const RunInfo &info, const string action) {
+    if (info.nEventsPerChunk == gConfig.nEventsPerChunk)
+        return true;
+    std::cout << "Cannot " << action << ": the run has chunks of " << info.nEventsPerChunk << " events, not " << gConfig.nEventsPerChunk << " (set nEventsPerChunk=" << info.nEventsPerChunk << ")" << std::endl;
+    return false;
+}
+
+// Generate the events still missing to reach info.nTargetEvents, adding them to histograms.
+// Events are split in chunks of info.nEventsPerChunk, each filling its own histograms;
+// event e draws from stream e of a PhiloxRandom seeded with seed, so the seed, the first
+// event and the number of events done are the whole random state of a run. Chunks are
+// distributed among nThreads workers and merged in chunk order as soon as possible, so for
+// a given seed the output depends neither on the number of threads nor on the run being
+// interrupted and resumed. Every gConfig.checkpointInterval merged chunks the state is
+// saved in gConfig.checkpointFile, unless checkpoints is false
+static void RunChunks(Histograms &histograms, RunInfo &info, int nThreads, EventStoreWriter *writer, bool checkpoints = true) {
+    if (nThreads < 1)
+        nThreads = 1;
+    if (nThreads > 1)
+        ROOT::EnableThreadSafety();
+
+    // Pair categories are resolved once from the registered types
+    PROFILE_SCOPE(kRun);
+    const PairTable pairTable;
+
+    const int nEventsPerChunk = info.nEventsPerChunk;
+    const int firstChunk = info.nChunks;
+    const int nChunks = firstChunk + (info.nTargetEvents - info.nEvents + nEventsPerChunk - 1) / nEventsPerChunk;
+    const Long64_t firstEvent = info.firstEvent + info.nEvents;
+    const Long64_t endEvent = info.firstEvent + info.nTargetEvents;
+    vector<Histograms *> chunkHistograms(nChunks, (Histograms *) 0);
+    vector<int> chunkEvents(nChunks, 0);
+    int nextMerge = firstChunk;
+    int lastCheckpoint = firstChunk;
+    mutex mergeMutex;
+
+    // Workers pick the next chunk to simulate until all chunks are done
+    atomic<int> nextChunk(firstChunk);
+    auto worker = [&]() {
+        PhiloxRandom rng(info.seed);
+        EventArena arena;
+        EventBlock block;
+        for (int c = nextChunk++; c < nChunks; c = nextChunk++) {
+            Histograms *h = new Histograms();
+            const Long64_t chunkFirstEvent = firstEvent + (Long64_t) (c - firstChunk) * nEventsPerChunk;
+            const int nEvents = min<Long64_t>(nEventsPerChunk, endEvent - chunkFirstEvent);
+            GenerateEvents(*h, pairTable, &rng, chunkFirstEvent, nEvents, writer ? &block : 0, &arena);
+            if (writer) {
+                writer->WriteBlock(c, block);
+                block.Clear();
             }
 
-            // Fill histogram with invariant masses of K* daughters
-            if (j >= N_PARTICLES_PER_ITERATION && j % 2 == 0)
-                daughtersInvMassH->Fill(particles[j].InvMass(&particles[j + 1]));
+            // Merge all consecutive completed chunks, always in chunk order
+            lock_guard<mutex> lock(mergeMutex);
+            PROFILE_SCOPE(kMerge);
+            chunkHistograms[c] = h;
+            chunkEvents[c] = nEvents;
+            while (nextMerge < nChunks && chunkHistograms[nextMerge]) {
+                histograms.Add(*chunkHistograms[nextMerge]);
+                delete chunkHistograms[nextMerge];
+                chunkHistograms[nextMerge] = 0;
+                info.nEvents += chunkEvents[nextMerge];
+                info.nChunks = ++nextMerge;
+            }
+            PROFILE_STOP(kMerge);
+            if (checkpoints && gConfig.checkpointInterval > 0 && nextMerge - lastCheckpoint >= gConfig.checkpointInterval && nextMerge < nChunks) {
+                WriteRun(gConfig.checkpointFile, histograms, info);
+                lastCheckpoint = nextMerge;
+            }
         }
+        PROFILE_COLLECT();
+    };
+
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++)
+        threads.push_back(thread(worker));
+    worker();
+    for (thread &t : threads)
+        t.join();
+}
+
+// Generate gConfig.nIterations events in memory, without checkpoints, and return their
+// histograms, to be deleted by the caller, or 0 if the particle catalog cannot be loaded.
+// info is set to the state of the run. If eventsFileName is given, all events are also
+// saved there (see EventStore)
+Histograms *GenerateHistograms(RunInfo &info, int nThreads, unsigned int seed, const char *eventsFileName) {
+    if (!InitParticleTypes())
+        return 0;
+
+    EventStoreWriter *writer = eventsFileName ? new EventStoreWriter(eventsFileName) : 0;
+
+    Histograms *histograms = new Histograms();
+    info = {seed, 0, 0, gConfig.nIterations, 0, gConfig.nEventsPerChunk};
+    RunChunks(*histograms, info, nThreads, writer, false);
+    delete writer;
+    PROFILE_REPORT("generation");
+    return histograms;
+}
+
+// Generate gConfig.nIterations events and save the histograms in gConfig.histogramsFile.
+// If eventsFileName is given, all events are also saved there (see EventStore)
+void GenerateParticles(int nThreads, unsigned int seed, const char *eventsFileName) {
+    // Initialization of particle types
+    if (!InitParticleTypes())
+        return;
+
+    EventStoreWriter *writer = eventsFileName ? new EventStoreWriter(eventsFileName) : 0;
+
+    Histograms histograms;
+    RunInfo info = {seed, 0, 0, gConfig.nIterations, 0, gConfig.nEventsPerChunk};
+    RunChunks(histograms, info, nThreads, writer);
+    delete writer;
+
+    // Save histograms in root file
+    WriteRun(gConfig.histogramsFile, histograms, info);
+    remove(gConfig.checkpointFile.c_str());
+    PROFILE_REPORT("generation");
+}
+
+// Generate events in steps of gConfig.adaptiveInterval, rounded up to whole chunks, and fit
+// the K* peak of the discordant minus concordant pion/kaon pairs after each step, as
+// AnalyzeData does, until the errors of its mean and sigma are below gConfig.targetMassError
+// and gConfig.targetWidthError or gConfig.nIterations events are done. Each fit is printed
+// and written in gConfig.traceFile. The histograms saved in gConfig.histogramsFile are those
+// of a GenerateParticles run of as many events, which can be extended later. No checkpoints
+// are saved: their target would be the end of a step, and resuming one would stop there
+// without the convergence checks, so an interrupted adaptive run is started again
+void GenerateAdaptive(int nThreads, unsigned int seed) {
+    if (!InitParticleTypes())
+        return;
+    ofstream trace(gConfig.traceFile);
+    if (!trace) {
+        std::cout << "Cannot write the convergence trace in " << gConfig.traceFile << std::endl;
+        return;
     }
+    trace << "# events mass massError sigma sigmaError" << endl;
 
-    file->Write();
-    file->Close();
-}
\ No newline at end of file
+    const int nEventsPerChunk = gConfig.nEventsPerChunk;
+    const Long64_t step = (Long64_t) max(1, (gConfig.adaptiveInterval + nEventsPerChunk - 1) / nEventsPerChunk) * nEventsPerChunk;
+    Histograms histograms;
+    RunInfo info = {seed, 0, 0, 0, 0, gConfig.nEventsPerChunk};
+    bool converged = false;
+    while (!converged && info.nEvents < gConfig.nIterations) {
+        info.nTargetEvents = min(info.nEvents + step, gConfig.nIterations);
+        RunChunks(histograms, info, nThreads, 0, false);
+
+        // Fit the peak on a snapshot of the histograms; a failed fit has no errors
+        TH1 *differenceH = histograms.discordantPionKaonInvMassH->ToTH1();
+        TH1 *concordantH = histograms.concordantPionKaonInvMassH->ToTH1();
+        differenceH->Add(concordantH, -1.0);
+        TF1 *fit = FitGaussianPeak(differenceH);
+        const double mass = fit ? fit->GetParameter(1) : 0, massError = fit ? fit->GetParError(1) : 0;
+        const double sigma = fit ? abs(fit->GetParameter(2)) : 0, sigmaError = fit ? fit->GetParError(2) : 0;
+        delete differenceH;
+        delete concordantH;
+
+        trace << info.nEvents << " " << mass << " " << massError << " " << sigma << " " << sigmaError << endl;
+        std::cout << info.nEvents << " events: K* mass " << mass << " +/- " << massError << ", sigma " << sigma << " +/- " << sigmaError << std::endl;
+        converged = massError > 0 && massError < gConfig.targetMassError && sigmaError > 0 && sigmaError < gConfig.targetWidthError;
+    }
+    if (converged)
+        std::cout << "K* peak converged after " << info.nEvents << " events" << std::endl;
+    else
+        std::cout << "K* peak not converged after " << info.nEvents << " events, the maximum" << std::endl;
+
+    WriteRun(gConfig.histogramsFile, histograms, info);
+    remove(gConfig.checkpointFile.c_str());
+    PROFILE_REPORT("generation");
+}
+
+// Name of the file of a shard: fileName with _<shard> before its extension
+string ShardFileName(const string fileName, int shard) {
+    const size_t dot = fileName.find_last_of('.');
+    const size_t slash = fileName.find_last_of('/');
+    const size_t end = dot != string::npos && (slash == string::npos || dot > slash) ? dot : fileName.size();
+    return fileName.substr(0, end) + "_" + to_string(shard) + fileName.substr(end);
+}
+
+// Generate shard shard of nShards of the run of gConfig.nIterations events, i.e. its chunks
+// from shard * nChunks / nShards on, in ShardFileName(gConfig.histogramsFile, shard) (and the
+// same for the checkpoint and events files). Shards draw from the streams of their own
+// events and start on a chunk boundary, where the whole run also restarts event mixing, so
+// they are independent processes and, merged by MergeRuns, give the same histograms as the
+// whole run with the same nEventsPerChunk
+void GenerateShard(int shard, int nShards, int nThreads, unsigned int seed, const char *eventsFileName) {
+    if (nShards < 1 || shard < 0 || shard >= nShards) {
+        std::cout << "Invalid shard " << shard << " of " << nShards << std::endl;
+        return;
+    }
+    if (!InitParticleTypes())
+        return;
+    gConfig.histogramsFile = ShardFileName(gConfig.histogramsFile, shard);
+    gConfig.checkpointFile = ShardFileName(gConfig.checkpointFile, shard);
+    const string shardEventsFileName = eventsFileName ? ShardFileName(eventsFileName, shard) : "";
+
+    EventStoreWriter *writer = eventsFileName ? new EventStoreWriter(shardEventsFileName.c_str()) : 0;
+
+    const Long64_t nChunks = (gConfig.nIterations + gConfig.nEventsPerChunk - 1) / gConfig.nEventsPerChunk;
+    const Long64_t firstEvent = min(nChunks * shard / nShards * gConfig.nEventsPerChunk, gConfig.nIterations);
+    const Long64_t endEvent = min(nChunks * (shard + 1) / nShards * gConfig.nEventsPerChunk, gConfig.nIterations);
+    Histograms histograms;
+    RunInfo info = {seed, 0, 0, endEvent - firstEvent, firstEvent, gConfig.nEventsPerChunk};
+    RunChunks(histograms, info, nThreads, writer);
+    delete writer;
+
+    WriteRun(gConfig.histogramsFile, histograms, info);
+    remove(gConfig.checkpointFile.c_str());
+    PROFILE_REPORT("generation");
+}
+
+// Add up the runs saved in inputFileNames, the complete shards of one run, and save the
+// result in outputFileName as a single run, ready for AnalyzeData or ExtendParticles. The
+// histograms must have the binning of the current parameters
+bool MergeRuns(const vector<string> &inputFileNames, const string outputFileName) {
+    if (inputFileNames.empty()) {
+        std::cout << "Nothing to merge" << std::endl;
+        return false;
+    }
+    if (!InitParticleTypes())
+        return false;
+
+    Histograms histograms, shardHistograms;
+    vector<RunInfo> infos(inputFileNames.size());
+    for (size_t i = 0; i < inputFileNames.size(); i++) {
+        if (!ReadRun(inputFileNames[i], shardHistograms, infos[i])) {
+            std::cout << "Cannot merge: no valid run in " << inputFileNames[i] << std::endl;
+            return false;
+        }
+        if (infos[i].nEvents != infos[i].nTargetEvents) {
+            std::cout << "Cannot merge: " << inputFileNames[i] << " is incomplete, resume it first" << std::endl;
+            return false;
+        }
+        histograms.Add(shardHistograms);
+    }
+
+    // Shards must cover consecutive events of the same seed, without gaps or overlaps
+    vector<size_t> order(infos.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    // Shards with no events, when there are more shards than chunks, go before the one
+    // starting at the same event
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) { return infos[a].firstEvent < infos[b].firstEvent || (infos[a].firstEvent == infos[b].firstEvent && infos[a].nEvents < infos[b].nEvents); });
+    RunInfo info = {infos[order[0]].seed, 0, 0, 0, infos[order[0]].firstEvent, infos[order[0]].nEventsPerChunk};
+    for (size_t i : order) {
+        if (infos[i].nEventsPerChunk != info.nEventsPerChunk) {
+            std::cout << "Cannot merge: " << inputFileNames[i] << " has chunks of " << infos[i].nEventsPerChunk << " events, not " << info.nEventsPerChunk << std::endl;
+            return false;
+        }
+        if (infos[i].seed != info.seed || infos[i].firstEvent != info.firstEvent + info.nEvents) {
+            std::cout << "Cannot merge: " << inputFileNames[i] << " is not the shard following the others" << std::endl;
+            return false;
+        }
+        info.nChunks += infos[i].nChunks;
+        info.nEvents += infos[i].nEvents;
+    }
+    info.nTargetEvents = info.nEvents;
+
+    WriteRun(outputFileName, histograms, info);
+    std::cout << "Merged " << inputFileNames.size() << " runs of " << info.nEvents << " events in " << outputFileName << std::endl;
+    return true;
+}
+
+// Continue the run saved in gConfig.checkpointFile by an interrupted GenerateParticles or
+// ExtendParticles, with the same nEventsPerChunk. Events are not saved when resuming: the
+// event file of an interrupted run has no index and cannot be read, so a run saving its
+// events has to be generated again
+void ResumeParticles(int nThreads) {
+    if (!gConfig.eventsFile.empty()) {
+        std::cout << "Cannot resume a run saving its events in " << gConfig.eventsFile << ": generate it again" << std::endl;
+        return;
+    }
+    if (!InitParticleTypes())
+        return;
+
+    Histograms histograms;
+    RunInfo info;
+    if (!ReadRun(gConfig.checkpointFile, histograms, info)) {
+        std::cout << "Cannot resume: no valid checkpoint in " << gConfig.checkpointFile << std::endl;
+        return;
+    }
+    if (!HasCurrentChunks(info, "resume"))
+        return;
+    std::cout << "Resuming from event " << info.nEvents << " of " << info.nTargetEvents << std::endl;
+
+    RunChunks(histograms, info, nThreads, 0);
+    WriteRun(gConfig.histogramsFile, histograms, info);
+    remove(gConfig.checkpointFile.c_str());
+    PROFILE_REPORT("generation");
+}
+
+// Add nEvents more events to the run saved in gConfig.histogramsFile, continuing its random
+// sequence with the same nEventsPerChunk
+void ExtendParticles(Long64_t nEvents, int nThreads) {
+    if (!InitParticleTypes())
+        return;
+
+    Histograms histograms;
+    RunInfo info;
+    if (!ReadRun(gConfig.histogramsFile, histograms, info)) {
+        std::cout << "Cannot extend: no valid run in " << gConfig.histogramsFile << std::endl;
+        return;
+    }
+    if (!HasCurrentChunks(info, "extend"))
+        return;
+    info.nTargetEvents = info.nEvents + nEvents;
+    std::cout << "Extending run from " << info.nEvents << " to " << info.nTargetEvents << " events" << std::endl;
+
+    RunChunks(histograms, info, nThreads, 0);
+    WriteRun(gConfig.histogramsFile, histograms, info);
+    remove(gConfig.checkpointFile.c_str());
+    PROFILE_REPORT("generation");
+}
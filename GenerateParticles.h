@@ -0,0 +1,41 @@
+#include "EventArena.h"
+#include "EventStore.h"
+#include "Histograms.h"
+#include "PairTable.h"
+#include "PhiloxRandom.h"
+
+#include <string>
+#include <vector>
+
+#ifndef GENERATE_PARTICLES_H
+#define GENERATE_PARTICLES_H
+
+using namespace std;
+
+// State of a generation run, saved with its histograms
+struct RunInfo {
+    unsigned int seed;
+    int nChunks;            // Chunks done
+    Long64_t nEvents;       // Events done
+    Long64_t nTargetEvents; // Events to generate in total
+    Long64_t firstEvent;    // First event, nonzero for the shards of a run but the first
+    int nEventsPerChunk;    // Events of a chunk, on whose boundaries event mixing restarts
+};
+
+bool InitParticleTypes();
+vector<double> SpeciesProbabilities();
+vector<double> SamplingProbabilities();
+vector<double> SpeciesWeights();
+vector<double> MultiplicityProbabilities();
+void GenerateEvents(Histograms &h, const PairTable &pairTable, PhiloxRandom *rng, Long64_t firstEvent, int nEvents, EventBlock *block = 0, EventArena *arena = 0);
+void WriteRun(const string fileName, const Histograms &histograms, const RunInfo &info);
+Histograms *GenerateHistograms(RunInfo &info, int nThreads = 1, unsigned int seed = 4357, const char *eventsFileName = 0);
+void GenerateParticles(int nThreads = 1, unsigned int seed = 4357, const char *eventsFileName = 0);
+void ResumeParticles(int nThreads = 1);
+void ExtendParticles(Long64_t nEvents, int nThreads = 1);
+void GenerateAdaptive(int nThreads = 1, unsigned int seed = 4357);
+string ShardFileName(const string fileName, int shard);
+void GenerateShard(int shard, int nShards, int nThreads = 1, unsigned int seed = 4357, const char *eventsFileName = 0);
+bool MergeRuns(const vector<string> &inputFileNames, const string outputFileName);
+
+#endif
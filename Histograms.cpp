@@ -0,0 +1,86 @@
+#include "Histograms.h"
+
+#include "Config.h"
+#include "Parameters.h"
+#include "Particle.h"
+#include <cmath>
+#include <iostream>
+
+Histograms::Histograms() {
+    const int nTypes = Particle::GetNParticleTypes();
+    particleTypesH = new FixedHistogram("particleTypesH", "Particle Types", nTypes, 0, nTypes, true);
+    finalParticleTypesH = new FixedHistogram("finalParticleTypesH", "Final Particle Types", nTypes, 0, nTypes, true);
+    azimutAngleH = new FixedHistogram("azimutAngleH", "Azimut Angle", gConfig.nBins, 0, 2 * M_PI);
+    polarAngleH = new FixedHistogram("polarAngleH", "Polar Angle", gConfig.nBins, 0, M_PI);
+    momentumH = new FixedHistogram("momentumH", "Momentum", gConfig.nBins, 0, gConfig.maxMomentum);
+    transverseMomentumH = new FixedHistogram("transverseMomentumH", "Transverse Momentum", gConfig.nBins, 0, gConfig.maxMomentum);
+    particleEnergyH = new FixedHistogram("particleEnergyH", "Particle Energy", gConfig.nBins, 0, gConfig.maxEnergy);
+    invMassH = new FixedHistogram("invMassH", "Invariant Mass", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+    discordantInvMassH = new FixedHistogram("discordantInvMassH", "Discordant Invariant Mass", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+    concordantInvMassH = new FixedHistogram("concordantInvMassH", "Concordant Invariant Mass", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+    discordantPionKaonInvMassH = new FixedHistogram("discordantPionKaonInvMassH", "Discordant Pion/Kaon Invariant Mass", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+    concordantPionKaonInvMassH = new FixedHistogram("concordantPionKaonInvMassH", "Concordant Pion/Kaon Invariant Mass", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+    daughtersInvMassH = new FixedHistogram("daughtersInvMassH", "Resonance Daughters Invariant Mass", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+    mixedPionKaonInvMassH = new FixedHistogram("mixedPionKaonInvMassH", "Mixed Events Discordant Pion/Kaon Invariant Mass", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+
+    invMassH->Sumw2();
+    discordantInvMassH->Sumw2();
+    concordantInvMassH->Sumw2();
+    discordantPionKaonInvMassH->Sumw2();
+    concordantPionKaonInvMassH->Sumw2();
+    daughtersInvMassH->Sumw2();
+    mixedPionKaonInvMassH->Sumw2();
+
+    FixedHistogram *all[fNHistograms] = {
+        particleTypesH, finalParticleTypesH, azimutAngleH, polarAngleH, momentumH,
+        transverseMomentumH, particleEnergyH, invMassH, discordantInvMassH, concordantInvMassH,
+        discordantPionKaonInvMassH, concordantPionKaonInvMassH, daughtersInvMassH, mixedPionKaonInvMassH
+    };
+    for (int i = 0; i < fNHistograms; i++)
+        fAll[i] = all[i];
+}
+
+Histograms::~Histograms() {
+    for (int i = 0; i < fNHistograms; i++)
+        delete fAll[i];
+}
+
+void Histograms::Add(const Histograms &other) {
+    for (int i = 0; i < fNHistograms; i++)
+        fAll[i]->Add(*other.fAll[i]);
+}
+
+void Histograms::Reset() {
+    for (int i = 0; i < fNHistograms; i++)
+        fAll[i]->Reset();
+}
+
+FixedHistogram *Histograms::Get(int id) const {
+    return fAll[id];
+}
+
+// Convert all histograms to TH1 and write them in the current directory (usually an open TFile)
+void Histograms::Write() const {
+    for (int i = 0; i < fNHistograms; i++) {
+        TH1 *h = fAll[i]->ToTH1();
+        h->Write();
+        delete h;
+    }
+}
+
+// Read back histograms written by Write from the given directory, with the same binning
+bool Histograms::Read(TDirectory *directory) {
+    for (int i = 0; i < fNHistograms; i++) {
+        TH1 *h = (TH1*) directory->Get(fAll[i]->GetName().c_str());
+        if (!h) {
+            std::cout << "Histogram " << fAll[i]->GetName() << " not found in " << directory->GetName() << std::endl;
+            return false;
+        }
+        if (h->GetNbinsX() != fAll[i]->GetNBins() || h->GetXaxis()->GetXmin() != fAll[i]->GetMin() || h->GetXaxis()->GetXmax() != fAll[i]->GetMax()) {
+            std::cout << "Histogram " << fAll[i]->GetName() << " in " << directory->GetName() << " has a different binning" << std::endl;
+            return false;
+        }
+        fAll[i]->Import(h);
+    }
+    return true;
+}
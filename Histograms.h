@@ -0,0 +1,54 @@
+#include "FixedHistogram.h"
+
+#include <TDirectory.h>
+
+#ifndef HISTOGRAMS_H
+#define HISTOGRAMS_H
+
+using namespace std;
+
+// Set of the histograms filled by GenerateParticles. They are kept as FixedHistogram,
+// so that independent copies can be filled concurrently and merged, and converted to
+// ROOT histograms only when written
+class Histograms {
+    public:
+        Histograms();
+        ~Histograms();
+        void Add(const Histograms &other);
+        void Reset();
+        void Write() const;
+        bool Read(TDirectory *directory);
+        FixedHistogram *Get(int id) const;
+
+        // Histogram ids, in the order they are stored and written
+        enum {
+            kParticleTypes, kFinalParticleTypes, kAzimutAngle, kPolarAngle, kMomentum,
+            kTransverseMomentum, kParticleEnergy, kInvMass, kDiscordantInvMass, kConcordantInvMass,
+            kDiscordantPionKaonInvMass, kConcordantPionKaonInvMass, kDaughtersInvMass, kMixedPionKaonInvMass
+        };
+
+        FixedHistogram *particleTypesH;
+        FixedHistogram *finalParticleTypesH;
+        FixedHistogram *azimutAngleH;
+        FixedHistogram *polarAngleH;
+        FixedHistogram *momentumH;
+        FixedHistogram *transverseMomentumH;
+        FixedHistogram *particleEnergyH;
+        FixedHistogram *invMassH;
+        FixedHistogram *discordantInvMassH;
+        FixedHistogram *concordantInvMassH;
+        FixedHistogram *discordantPionKaonInvMassH;
+        FixedHistogram *concordantPionKaonInvMassH;
+        FixedHistogram *daughtersInvMassH;
+        FixedHistogram *mixedPionKaonInvMassH;
+
+        static const int fNHistograms = 14;
+
+    private:
+        FixedHistogram *fAll[fNHistograms];
+
+        Histograms(const Histograms &) = delete;
+        Histograms &operator=(const Histograms &) = delete;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "Config.h"
+#include "GenerateParticles.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Merge the shards of a run generated by "simulate shard <k> <K>" in one file that
+// AnalyzeData and ExtendParticles read as a run generated at once. Only one shard at a time
+// is kept in memory besides the sum, so any number of shards can be merged. Run parameters
+// are read as in the main executable (--key=value, --config=file)
+
+int main(int argc, char **argv) {
+    vector<string> arguments;
+    if (!gConfig.ParseArguments(argc, argv, arguments) || arguments.size() < 2) {
+        std::cout << "Usage: " << argv[0] << " [--key=value ...] output.root shard.root ..." << std::endl;
+        return 1;
+    }
+    const vector<string> inputFileNames(arguments.begin() + 1, arguments.end());
+    return MergeRuns(inputFileNames, arguments[0]) ? 0 : 1;
+}
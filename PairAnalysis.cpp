@@ -0,0 +1,98 @@
+#include "PairAnalysis.h"
+
+#include "Profiler.h"
+
+#include <algorithm>
+
+using namespace std;
+
+PairAnalysis::PairAnalysis(const PairTable &pairTable, int capacity, int mixingDepth) :
+    fPairTable(pairTable), fCapacity(0), fInvMasses(0), fMixer(pairTable, mixingDepth, capacity) {
+    for (int id = 0; id < Histograms::fNHistograms; id++)
+        fNTargetMasses[id] = 0;
+    Reserve(capacity);
+}
+
+PairAnalysis::~PairAnalysis() {
+    EventBuffer::FreeArray(fInvMasses);
+}
+
+// Make room for events of at least capacity particles, at least doubling the capacity
+void PairAnalysis::Reserve(int capacity) {
+    if (capacity <= fCapacity)
+        return;
+    fCapacity = max(capacity, 2 * fCapacity);
+    EventBuffer::FreeArray(fInvMasses);
+    fInvMasses = EventBuffer::AllocateArray(fCapacity);
+    fTargetMasses.assign(Histograms::fNHistograms * fCapacity, 0);
+    fTargetWeights.assign(Histograms::fNHistograms * fCapacity, 0);
+    fRoots.assign(fCapacity, 0);
+}
+
+void PairAnalysis::Fill(Histograms &h, const EventBuffer &buffer, const double *weights) {
+    const int nParticles = buffer.GetSize();
+    const int *indices = buffer.GetIndex();
+    const int *parents = buffer.GetParent();
+    Reserve(nParticles);
+
+    // Decay products follow their mothers, so roots are found in one pass
+    if (weights) {
+        for (int j = 0; j < nParticles; j++)
+            fRoots[j] = parents[j] < 0 ? j : fRoots[parents[j]];
+    }
+
+    PROFILE_SCOPE(kPairs);
+    for (int j = 0; j < nParticles; j++) {
+
+        // Species id of particle j
+        const int index1 = indices[j];
+
+        // Skip particles that do not enter any pair (K*)
+        if (fPairTable.HasTargets(index1)) {
+
+            // Invariant masses with all previous particles in the event
+            buffer.InvMasses(j, 0, j, fInvMasses);
+            PROFILE_COUNT(Profiler::kPairsEvaluated, j);
+
+            for (int k = 0; k < j; k++) {
+
+                // Look up the histograms filled by this pair of species
+                const int nTargets = fPairTable.GetNTargets(index1, indices[k]);
+                const int *targets = fPairTable.GetTargets(index1, indices[k]);
+                for (int t = 0; t < nTargets; t++) {
+                    const int id = targets[t];
+                    if (weights)
+                        fTargetWeights[id * fCapacity + fNTargetMasses[id]] = weights[j] * (fRoots[k] == fRoots[j] ? 1 : weights[k]);
+                    fTargetMasses[id * fCapacity + fNTargetMasses[id]++] = fInvMasses[k];
+                }
+            }
+
+            // Fill target histograms in batch
+            PROFILE_SCOPE(kPairFills);
+            for (int id = 0; id < Histograms::fNHistograms; id++) {
+                if (fNTargetMasses[id] > 0) {
+                    PROFILE_COUNT(Profiler::kPairsFilled + id, fNTargetMasses[id]);
+                    if (weights)
+                        h.Get(id)->FillN(fNTargetMasses[id], &fTargetMasses[id * fCapacity], &fTargetWeights[id * fCapacity]);
+                    else
+                        h.Get(id)->FillN(fNTargetMasses[id], &fTargetMasses[id * fCapacity]);
+                    fNTargetMasses[id] = 0;
+                }
+            }
+        }
+
+        // Fill histogram with invariant masses of the daughters of two-body decays, stored next to each other
+        const bool firstDaughter = parents[j] >= 0 && (j == 0 || parents[j - 1] != parents[j]);
+        if (firstDaughter && j + 1 < nParticles && parents[j + 1] == parents[j] && (j + 2 == nParticles || parents[j + 2] != parents[j])) {
+            PROFILE_COUNT(Profiler::kPairsFilled + Histograms::kDaughtersInvMass, 1);
+            if (weights)
+                h.daughtersInvMassH->Fill(buffer.InvMass(j, j + 1), weights[j]);
+            else
+                h.daughtersInvMassH->Fill(buffer.InvMass(j, j + 1));
+        }
+    }
+    PROFILE_STOP(kPairs);
+
+    PROFILE_SCOPE(kMixing);
+    fMixer.Fill(h.mixedPionKaonInvMassH, buffer, weights);
+}
@@ -0,0 +1,44 @@
+#include "EventBuffer.h"
+#include "EventMixer.h"
+#include "Histograms.h"
+#include "PairTable.h"
+
+#include <vector>
+
+#ifndef PAIR_ANALYSIS_H
+#define PAIR_ANALYSIS_H
+
+using namespace std;
+
+// Fills the invariant mass histograms of an event held in an EventBuffer: all pairs
+// according to the PairTable, the pairs of daughters of the same resonance and the
+// pairs with the previous mixingDepth events (see EventMixer). Its arrays grow with the events.
+// Given the importance weights of the particles, pairs are filled with the product of the
+// weights of their primaries (see SpeciesWeights)
+class PairAnalysis {
+    public:
+        PairAnalysis(const PairTable &pairTable, int capacity, int mixingDepth);
+        ~PairAnalysis();
+        void Fill(Histograms &h, const EventBuffer &buffer, const double *weights = 0);
+
+    private:
+        const PairTable &fPairTable;
+        int fCapacity;
+        Real *fInvMasses;
+        EventMixer fMixer;
+
+        void Reserve(int capacity);
+
+        // Invariant masses of the current particle grouped by target histogram, for batched fills
+        vector<Real> fTargetMasses;
+        vector<double> fTargetWeights;
+        int fNTargetMasses[Histograms::fNHistograms];
+
+        // Position of the primary each particle comes from, for weighted fills
+        vector<int> fRoots;
+
+        PairAnalysis(const PairAnalysis &) = delete;
+        PairAnalysis &operator=(const PairAnalysis &) = delete;
+};
+
+#endif
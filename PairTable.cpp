@@ -0,0 +1,66 @@
+#include "PairTable.h"
+
+#include "Histograms.h"
+#include "Particle.h"
+#include "ParticleType.h"
+
+using namespace std;
+
+PairTable::PairTable() {
+    fNTypes = Particle::GetNParticleTypes();
+    fNTargets.assign(fNTypes * fNTypes, 0);
+    fTargets.assign(fNTypes * fNTypes * fMaxTargets, -1);
+    fHasTargets.assign(fNTypes, false);
+
+    // Pions and kaons of the catalog, -1 if missing
+    const int pionPlus = Particle::FindParticle("π+"), pionMinus = Particle::FindParticle("π-");
+    const int kaonPlus = Particle::FindParticle("K+"), kaonMinus = Particle::FindParticle("K-");
+
+    for (int i = 0; i < fNTypes; i++) {
+        const ParticleType *p1 = Particle::GetParticleType(i);
+        for (int j = 0; j < fNTypes; j++) {
+            const ParticleType *p2 = Particle::GetParticleType(j);
+
+            // Neutral particles and resonances, which decay (K*), are ignored for invariant mass histograms
+            if (p1->GetCharge() == 0 || p2->GetCharge() == 0 || Particle::GetNDecayChannels(i) > 0 || Particle::GetNDecayChannels(j) > 0)
+                continue;
+
+            AddTarget(i, j, Histograms::kInvMass);
+            AddTarget(i, j, p1->GetCharge() != p2->GetCharge() ? Histograms::kDiscordantInvMass : Histograms::kConcordantInvMass);
+
+            // Pion/kaon pairs, in either order
+            const bool pion1 = i == pionPlus || i == pionMinus, kaon1 = i == kaonPlus || i == kaonMinus;
+            const bool pion2 = j == pionPlus || j == pionMinus, kaon2 = j == kaonPlus || j == kaonMinus;
+            const bool pionKaon = (kaon1 && pion2) || (kaon2 && pion1);
+            if (pionKaon)
+                AddTarget(i, j, p1->GetCharge() != p2->GetCharge() ? Histograms::kDiscordantPionKaonInvMass : Histograms::kConcordantPionKaonInvMass);
+        }
+    }
+}
+
+void PairTable::AddTarget(int index1, int index2, int histogram) {
+    const int pair = index1 * fNTypes + index2;
+    fTargets[pair * fMaxTargets + fNTargets[pair]] = histogram;
+    fNTargets[pair]++;
+    fHasTargets[index1] = true;
+}
+
+int PairTable::GetNTargets(int index1, int index2) const {
+    return fNTargets[index1 * fNTypes + index2];
+}
+
+const int *PairTable::GetTargets(int index1, int index2) const {
+    return &fTargets[(index1 * fNTypes + index2) * fMaxTargets];
+}
+
+bool PairTable::HasTargets(int index) const {
+    return fHasTargets[index];
+}
+
+bool PairTable::IsTarget(int index1, int index2, int histogram) const {
+    const int *targets = GetTargets(index1, index2);
+    for (int t = 0; t < GetNTargets(index1, index2); t++)
+        if (targets[t] == histogram)
+            return true;
+    return false;
+}
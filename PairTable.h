@@ -0,0 +1,29 @@
+#ifndef PAIR_TABLE_H
+#define PAIR_TABLE_H
+
+#include <vector>
+
+using namespace std;
+
+// Lookup table built once from the registered particle types: for each pair of species
+// ids it lists the ids of the invariant mass histograms (see Histograms) the pair fills
+class PairTable {
+    public:
+        PairTable();
+        int GetNTargets(int index1, int index2) const;
+        const int *GetTargets(int index1, int index2) const;
+        bool HasTargets(int index) const;
+        bool IsTarget(int index1, int index2, int histogram) const;
+
+        static const int fMaxTargets = 3;
+
+    private:
+        int fNTypes;
+        vector<int> fNTargets;
+        vector<int> fTargets;
+        vector<bool> fHasTargets;
+
+        void AddTarget(int index1, int index2, int histogram);
+};
+
+#endif
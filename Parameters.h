@@ -5,10 +5,11 @@ using namespace std;
 #ifndef PARAMETERS_H
 #define PARAMETERS_H
 
-const int N_PARTICLE_TYPES = 7;
 const int N_ITERATIONS = 1E5;
 const int N_PARTICLES_PER_ITERATION = 100;
-const int MAX_PRODUCTS = 200;
+const int N_EVENTS_PER_CHUNK = 1000;
+const int CHECKPOINT_INTERVAL = 10;        // Chunks merged between checkpoints, 0 disables checkpoints
+const int MAX_PRODUCTS = 200;              // Initial room for decay products, events grow beyond it as needed
 const double AVG_P = 1.0;
 const int N_BINS = 50;
 const int N_BINS_INV_MASS = 100;
@@ -16,57 +17,18 @@ const double MAX_MOMENTUM = 5.0;
 const double MAX_ENERGY = 8.0;
 const double MIN_INVARIANT_MASS = 0.5;
 const double MAX_INVARIANT_MASS = 1.5;
-
-const int PION_PLUS_BIN = 1;
-const int PION_MINUS_BIN = 2;
-const int KAON_PLUS_BIN = 3;
-const int KAON_MINUS_BIN = 4;
-const int PROTON_PLUS_BIN = 5;
-const int PROTON_MINUS_BIN = 6;
-const int KAON_STAR_BIN = 7;
-
-const double PION_PLUS_PROB = 0.4;
-const double PION_MINUS_PROB = 0.4;
-const double KAON_PLUS_PROB = 0.05;
-const double KAON_MINUS_PROB = 0.05;
-const double PROTON_PLUS_PROB = 0.045;
-const double PROTON_MINUS_PROB = 0.045;
-const double KAON_STAR_PROB = 0.01;
-
-const double PROBABILITIES[] = {
-    PION_PLUS_PROB,
-    PION_MINUS_PROB,
-    KAON_PLUS_PROB,
-    KAON_MINUS_PROB,
-    PROTON_PLUS_PROB,
-    PROTON_MINUS_PROB,
-    KAON_STAR_PROB
-};
-
-const string PION_PLUS_LABEL = "π+";
-const string PION_MINUS_LABEL = "π-";
-const string KAON_PLUS_LABEL = "K+";
-const string KAON_MINUS_LABEL = "K-";
-const string PROTON_PLUS_LABEL = "p+";
-const string PROTON_MINUS_LABEL = "p-";
-const string KAON_STAR_LABEL = "K*";
-
-const string LABELS[] = {
-    PION_PLUS_LABEL,
-    PION_MINUS_LABEL,
-    KAON_PLUS_LABEL,
-    KAON_MINUS_LABEL,
-    PROTON_PLUS_LABEL,
-    PROTON_MINUS_LABEL,
-    KAON_STAR_LABEL
-};
-
-const double PION_PLUS_CUMULATIVE = PION_PLUS_PROB;
-const double PION_MINUS_CUMULATIVE = PION_PLUS_CUMULATIVE + PION_MINUS_PROB;
-const double KAON_PLUS_CUMULATIVE = PION_MINUS_CUMULATIVE + KAON_PLUS_PROB;
-const double KAON_MINUS_CUMULATIVE = KAON_PLUS_CUMULATIVE + KAON_MINUS_PROB;
-const double PROTON_PLUS_CUMULATIVE = KAON_MINUS_CUMULATIVE + PROTON_PLUS_PROB;
-const double PROTON_MINUS_CUMULATIVE = PROTON_PLUS_CUMULATIVE + PROTON_MINUS_PROB;
-const double KAON_STAR_CUMULATIVE = PROTON_MINUS_CUMULATIVE + KAON_STAR_PROB;
+const int MIXING_DEPTH = 5;                 // Number of previous events paired with each event, 0 disables mixing
+const double MOMENTUM_RESOLUTION = 0;       // Relative momentum smearing of the detector, 0 disables it
+const double MIN_PEAK_INVARIANT_MASS = 0.7; // K* region excluded when normalizing the mixed-event background
+const double MAX_PEAK_INVARIANT_MASS = 1.1;
+const double ERROR_FACTOR = 3.0;            // Tolerance of the consistency checks, in standard deviations
+const int ADAPTIVE_INTERVAL = 10000;        // Events between fits of the K* peak in adaptive runs
+const double TARGET_MASS_ERROR = 1E-3;      // Adaptive runs stop when the K* peak mean and sigma have these errors
+const double TARGET_WIDTH_ERROR = 1E-3;
+
+const string PARTICLES_FILE = "particles.txt";
+const string HISTOGRAMS_FILE = "histograms.root";
+const string CHECKPOINT_FILE = "histograms.checkpoint.root";
+const string TRACE_FILE = "convergence.txt";
 
 #endif
\ No newline at end of file
@@ -2,21 +2,32 @@
 
 #include "ParticleType.h"
 #include "ResonanceType.h"
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <cmath>
 #include <cstdlib>
+#include <fstream>
+#include <sstream>
 
 using namespace std;
 
-int Particle::fNParticleType = 0;
-const ParticleType *Particle::fParticleType[Particle::fMaxNumParticleType];
-
-int Particle::FindParticle(string particleName) {
-    for (int i = 0; i < fNParticleType; i++)
-        if (fParticleType[i]->GetName() == particleName)
-            return i;
-    return -1;
+vector<const ParticleType *> Particle::fParticleType;
+unordered_map<string, int> Particle::fIndexByName;
+vector<double> Particle::fMasses, Particle::fWidths, Particle::fAbundances;
+vector<int> Particle::fCharges;
+vector<int> Particle::fFirstChannel, Particle::fNChannels;
+vector<double> Particle::fChannelCumulative;
+vector<int> Particle::fChannelFirstDaughter, Particle::fChannelNDaughters, Particle::fChannelDaughters;
+vector<int> Particle::fLineshapeFirst;
+vector<double> Particle::fLineshapes;
+
+// Masses of a resonance are sampled up to this many widths from the nominal mass
+static const double LINESHAPE_RANGE = 10;
+
+int Particle::FindParticle(const string &particleName) {
+    const unordered_map<string, int>::const_iterator it = fIndexByName.find(particleName);
+    return it == fIndexByName.end() ? -1 : it->second;
 }
 
 Particle::Particle() {
@@ -41,7 +52,7 @@ const ParticleType *Particle::GetParticleType() const {
 }
 
 void Particle::SetIndex(int index) {
-    if (index >= fNParticleType) {
+    if (index >= GetNParticleTypes()) {
         std::cout << "Cannot set index " << index << ": out of bounds error" << std::endl;
         return;
     }
@@ -57,27 +68,234 @@ void Particle::SetIndex(string particleName) {
     fIndex = index;
 }
 
-void Particle::AddParticleType(const string particleName, const double mass, const int charge, const double width) {
-    if (fNParticleType >= fMaxNumParticleType) {
-        std::cout << "Maximum number of particle types reached: cannot add new particle type" << std::endl;
+void Particle::AddParticleType(const string particleName, const double mass, const int charge, const double width, const double abundance) {
+    const int index = FindParticle(particleName);
+    if (index >= 0) {
+        std::cout << "Particle type " << particleName << " already exists: cannot add duplicate" << std::endl;
         return;
     }
 
+    fIndexByName[particleName] = fParticleType.size();
+    fParticleType.push_back(width == 0 ? new ParticleType(particleName, mass, charge) : new ResonanceType(particleName, mass, charge, width));
+    fMasses.push_back(mass);
+    fWidths.push_back(width);
+    fCharges.push_back(charge);
+    fAbundances.push_back(abundance);
+    fFirstChannel.push_back(fChannelCumulative.size());
+    fNChannels.push_back(0);
+    fLineshapeFirst.push_back(-1);
+    BuildLineshape(fParticleType.size() - 1);
+}
+
+// Sum of the masses of the daughters of a decay channel
+double Particle::GetThreshold(int channel) {
+    double threshold = 0;
+    for (int d = 0; d < fChannelNDaughters[channel]; d++)
+        threshold += fMasses[GetDaughters(channel)[d]];
+    return threshold;
+}
+
+// Change the mass and width of a particle type, e.g. to scan them, provided that every
+// decay channel stays open
+bool Particle::SetMassAndWidth(const string particleName, const double mass, const double width) {
     const int index = FindParticle(particleName);
-    if (index >= 0) {
-        std::cout << "Particle type " << particleName << " already exists: cannot add duplicate" << std::endl;
+    if (index < 0) {
+        std::cout << "Cannot set mass and width: particle type " << particleName << " not found" << std::endl;
+        return false;
+    }
+
+    const double oldMass = fMasses[index], oldWidth = fWidths[index];
+    fMasses[index] = mass;
+    fWidths[index] = width;
+    for (int i = 0; i < GetNParticleTypes(); i++) {
+        for (int channel = fFirstChannel[i]; channel < fFirstChannel[i] + fNChannels[i]; channel++) {
+            if (GetThreshold(channel) >= fMasses[i] + LINESHAPE_RANGE * fWidths[i]) {
+                std::cout << "Cannot set mass and width of " << particleName << ": a decay channel of " << fParticleType[i]->GetName() << " would close" << std::endl;
+                fMasses[index] = oldMass;
+                fWidths[index] = oldWidth;
+                return false;
+            }
+        }
+    }
+
+    const ParticleType *old = fParticleType[index];
+    fParticleType[index] = width == 0 ? new ParticleType(particleName, mass, fCharges[index]) : new ResonanceType(particleName, mass, fCharges[index], width);
+    delete old;
+    if (width == 0)
+        fLineshapeFirst[index] = -1;
+    for (int i = 0; i < GetNParticleTypes(); i++)
+        BuildLineshape(i);
+    return true;
+}
+
+// Tabulate the inverse cumulative distribution of the mass of a resonance, a relativistic
+// Breit-Wigner truncated above the heaviest final state of its decay channels, so that a
+// sampled mass can always decay in any channel
+void Particle::BuildLineshape(int index) {
+    const double mass = fMasses[index], width = fWidths[index];
+    if (width == 0)
         return;
+
+    double minMass = max(mass - LINESHAPE_RANGE * width, 0.0);
+    for (int channel = fFirstChannel[index]; channel < fFirstChannel[index] + fNChannels[index]; channel++)
+        minMass = max(minMass, GetThreshold(channel));
+    const double maxMass = mass + LINESHAPE_RANGE * width;
+
+    // Cumulative distribution by the trapezoidal rule on a grid finer than the table
+    const int nSteps = 64 * (fLineshapeSize - 1);
+    const double step = (maxMass - minMass) / nSteps;
+    vector<double> cumulative(nSteps + 1, 0.0);
+    double previous = 0;
+    for (int g = 0; g <= nSteps; g++) {
+        const double m = minMass + g * step;
+        const double density = m / ((m * m - mass * mass) * (m * m - mass * mass) + mass * mass * width * width);
+        if (g > 0)
+            cumulative[g] = cumulative[g - 1] + 0.5 * (previous + density) * step;
+        previous = density;
+    }
+
+    if (fLineshapeFirst[index] < 0) {
+        fLineshapeFirst[index] = fLineshapes.size();
+        fLineshapes.resize(fLineshapes.size() + fLineshapeSize);
+    }
+    double *table = &fLineshapes[fLineshapeFirst[index]];
+    int g = 0;
+    for (int i = 0; i < fLineshapeSize; i++) {
+        const double target = cumulative[nSteps] * i / (fLineshapeSize - 1);
+        while (g < nSteps - 1 && cumulative[g + 1] < target)
+            g++;
+        const double fraction = (target - cumulative[g]) / (cumulative[g + 1] - cumulative[g]);
+        table[i] = minMass + (g + min(max(fraction, 0.0), 1.0)) * step;
+    }
+}
+
+// Add a decay channel of the given parent type into the given (two or three) daughter types,
+// which may be resonances themselves. Channels of a type are kept contiguous, whatever the
+// order they are added in
+bool Particle::AddDecayChannel(const string parentName, const double branchingRatio, const vector<string> &daughterNames) {
+    const int parent = FindParticle(parentName);
+    if (parent < 0) {
+        std::cout << "Cannot add decay channel: particle type " << parentName << " not found" << std::endl;
+        return false;
+    }
+    if (daughterNames.size() != 2 && daughterNames.size() != 3) {
+        std::cout << "Cannot add decay channel of " << parentName << ": only two and three-body decays are supported" << std::endl;
+        return false;
     }
+    vector<int> daughters;
+    double threshold = 0;
+    for (const string &name : daughterNames) {
+        daughters.push_back(FindParticle(name));
+        if (daughters.back() < 0) {
+            std::cout << "Cannot add decay channel of " << parentName << ": particle type " << name << " not found" << std::endl;
+            return false;
+        }
+        threshold += fMasses[daughters.back()];
+    }
+    if (threshold >= fMasses[parent] + LINESHAPE_RANGE * fWidths[parent]) {
+        std::cout << "Cannot add decay channel of " << parentName << ": daughters heavier than the parent" << std::endl;
+        return false;
+    }
+
+    // Insert the channel after the last one of the parent, shifting those of other types
+    const int channel = fFirstChannel[parent] + fNChannels[parent];
+    for (int i = 0; i < GetNParticleTypes(); i++)
+        if (i != parent && fFirstChannel[i] >= channel)
+            fFirstChannel[i]++;
+    const double previous = fNChannels[parent] > 0 ? fChannelCumulative[channel - 1] : 0;
+    fChannelCumulative.insert(fChannelCumulative.begin() + channel, previous + branchingRatio);
+    fChannelFirstDaughter.insert(fChannelFirstDaughter.begin() + channel, fChannelDaughters.size());
+    fChannelNDaughters.insert(fChannelNDaughters.begin() + channel, daughters.size());
+    fChannelDaughters.insert(fChannelDaughters.end(), daughters.begin(), daughters.end());
+    fNChannels[parent]++;
+    BuildLineshape(parent);
+    return true;
+}
 
-    fParticleType[fNParticleType] = width == 0 ? new ParticleType(particleName, mass, charge) : new ResonanceType(particleName, mass, charge, width);
-    fNParticleType++;
+// Decay channel of the given type for a uniform random number u in [0, 1), according to
+// the branching ratios normalized to their sum
+int Particle::SampleDecayChannel(int index, double u) {
+    const int first = fFirstChannel[index];
+    const int last = first + fNChannels[index] - 1;
+    const double x = u * fChannelCumulative[last];
+    int channel = first;
+    while (channel < last && x >= fChannelCumulative[channel])
+        channel++;
+    return channel;
+}
+
+// Read particle types and decay channels from a catalog file. Lines are either
+//     name mass charge [width [abundance]]
+// or
+//     decay parent branchingRatio daughter1 daughter2 ...
+// with # starting a comment. Names are unique and numbers other than charges non-negative
+bool Particle::ReadParticleTypes(const string fileName) {
+    ifstream file(fileName.c_str());
+    if (!file) {
+        std::cout << "Cannot open particle catalog " << fileName << std::endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        stringstream stream(line.substr(0, line.find('#')));
+        string name;
+        if (!(stream >> name))
+            continue;
+
+        if (name == "decay") {
+            string parentName, daughterName;
+            double branchingRatio;
+            vector<string> daughterNames;
+            if (!(stream >> parentName >> branchingRatio)) {
+                std::cout << fileName << ":" << lineNumber << ": expected decay parent branchingRatio daughters" << std::endl;
+                return false;
+            }
+            if (!(branchingRatio >= 0)) {
+                std::cout << fileName << ":" << lineNumber << ": negative branching ratio " << branchingRatio << std::endl;
+                return false;
+            }
+            while (stream >> daughterName)
+                daughterNames.push_back(daughterName);
+            if (!AddDecayChannel(parentName, branchingRatio, daughterNames))
+                return false;
+        } else {
+            double mass, width = 0, abundance = 0;
+            int charge;
+            if (!(stream >> mass >> charge)) {
+                std::cout << fileName << ":" << lineNumber << ": expected name mass charge [width [abundance]]" << std::endl;
+                return false;
+            }
+            stream >> width >> abundance;
+            if (FindParticle(name) >= 0) {
+                std::cout << fileName << ":" << lineNumber << ": particle type " << name << " already defined" << std::endl;
+                return false;
+            }
+            if (!(mass >= 0 && width >= 0 && abundance >= 0)) {
+                std::cout << fileName << ":" << lineNumber << ": negative mass, width or abundance of " << name << std::endl;
+                return false;
+            }
+            AddParticleType(name, mass, charge, width, abundance);
+        }
+    }
+    return true;
 }
 
 void Particle::PrintParticleTypes() {
-    for (int i = 0; i < fNParticleType; i++)
+    for (int i = 0; i < GetNParticleTypes(); i++)
         fParticleType[i]->Print();
 }
 
+int Particle::GetNParticleTypes() {
+    return fParticleType.size();
+}
+
+const ParticleType *Particle::GetParticleType(int index) {
+    return fParticleType[index];
+}
+
 void Particle::Print() const {
     std::cout << fParticleType[fIndex]->GetName() << " [index = " << fIndex << "]" << std::endl <<
                  "\tP = (" << fPx << ", " << fPy << ", " << fPz << ")" << std::endl;
@@ -96,11 +314,12 @@ double Particle::GetPz() const {
 }
 
 double Particle::GetMass() const {
-    return fParticleType[fIndex]->GetMass();
+    return fMasses[fIndex];
 }
 
 double Particle::TotEnergy() const {
-    return sqrt(pow(GetMass(), 2) + pow(fPx, 2) + pow(fPy, 2) + pow(fPz, 2));
+    const double mass = fMasses[fIndex];
+    return sqrt(mass * mass + fPx * fPx + fPy * fPy + fPz * fPz);
 }
 
 double Particle::InvMass(Particle *p) const {
@@ -114,34 +333,21 @@ void Particle::SetP(double Px, double Py, double Pz) {
 }
 
 int Particle::Decay2Body(Particle &dau1, Particle &dau2) const {
+    return Decay2Body(dau1, dau2, gRandom);
+}
+
+// Same as above, drawing random numbers from the given generator (one per thread)
+int Particle::Decay2Body(Particle &dau1, Particle &dau2, TRandom *rng) const {
     if (GetMass() == 0.0) {
         printf("Decayment cannot be preformed if mass is zero\n");
         return 1;
     }
 
-    double massMot = GetMass();
+    // Mass of the mother from its lineshape
+    double massMot = SampleMass(fIndex, rng->Rndm());
     double massDau1 = dau1.GetMass();
     double massDau2 = dau2.GetMass();
 
-    // add width effect
-    if (fIndex > -1) {
-        // gaussian random numbers
-        float x1, x2, w, y1, y2;
-
-        double invnum = 1. / RAND_MAX;
-        do {
-            x1 = 2.0 * rand() * invnum - 1.0;
-            x2 = 2.0 * rand() * invnum - 1.0;
-            w = x1 * x1 + x2 * x2;
-        } while (w >= 1.0);
-
-        w = sqrt((-2.0 * log(w)) / w);
-        y1 = x1 * w;
-        y2 = x2 * w;
-
-        massMot += fParticleType[fIndex]->GetWidth() * y1;
-    }
-
     if (massMot < massDau1 + massDau2) {
         printf("Decayment cannot be preformed because mass is too low in this channel\n");
         return 2;
@@ -149,12 +355,14 @@ int Particle::Decay2Body(Particle &dau1, Particle &dau2) const {
 
     double pout = sqrt((massMot * massMot - (massDau1 + massDau2) * (massDau1 + massDau2)) * (massMot * massMot - (massDau1 - massDau2) * (massDau1 - massDau2))) / massMot * 0.5;
 
-    double norm = 2 * M_PI / RAND_MAX;
+    double norm = 2 * M_PI;
 
-    double phi = rand() * norm;
-    double theta = rand() * norm * 0.5 - M_PI / 2.;
-    dau1.SetP(pout * sin(theta) * cos(phi), pout * sin(theta) * sin(phi), pout * cos(theta));
-    dau2.SetP(-pout * sin(theta) * cos(phi), -pout * sin(theta) * sin(phi), -pout * cos(theta));
+    double phi = rng->Rndm() * norm;
+    double theta = rng->Rndm() * norm * 0.5 - M_PI / 2.;
+    double sinTheta = sin(theta), cosTheta = cos(theta);
+    double sinPhi = sin(phi), cosPhi = cos(phi);
+    dau1.SetP(pout * sinTheta * cosPhi, pout * sinTheta * sinPhi, pout * cosTheta);
+    dau2.SetP(-pout * sinTheta * cosPhi, -pout * sinTheta * sinPhi, -pout * cosTheta);
 
     double energy = sqrt(fPx * fPx + fPy * fPy + fPz * fPz + massMot * massMot);
 
@@ -162,16 +370,166 @@ int Particle::Decay2Body(Particle &dau1, Particle &dau2) const {
     double by = fPy / energy;
     double bz = fPz / energy;
 
+    // Daughter energies in the rest frame of the mother
+    dau1.Boost(bx, by, bz, sqrt(massDau1 * massDau1 + pout * pout));
+    dau2.Boost(bx, by, bz, sqrt(massDau2 * massDau2 + pout * pout));
+
+    return 0;
+}
+
+// Momentum of the daughters of a two-body decay of mass M into masses m1 and m2, in the
+// rest frame of the mother
+static double TwoBodyMomentum(double M, double m1, double m2) {
+    return sqrt((M * M - (m1 + m2) * (m1 + m2)) * (M * M - (m1 - m2) * (m1 - m2))) / M * 0.5;
+}
+
+// Three-body decay with uniform phase space, as two successive two-body decays: the mass
+// m12 of the (dau1, dau2) system is drawn with the phase space weight p3 * q, by rejection
+// against its maximum, then the system and dau3 are emitted back to back and the system
+// decays into dau1 and dau2, both isotropically
+int Particle::Decay3Body(Particle &dau1, Particle &dau2, Particle &dau3, TRandom *rng) const {
+    if (GetMass() == 0.0) {
+        printf("Decayment cannot be preformed if mass is zero\n");
+        return 1;
+    }
+
+    const double massMot = SampleMass(fIndex, rng->Rndm());
+    const double m1 = dau1.GetMass(), m2 = dau2.GetMass(), m3 = dau3.GetMass();
+    if (massMot < m1 + m2 + m3) {
+        printf("Decayment cannot be preformed because mass is too low in this channel\n");
+        return 2;
+    }
+
+    const double weightMax = TwoBodyMomentum(massMot, m1 + m2, m3) * TwoBodyMomentum(massMot - m3, m1, m2);
+    double m12, p3, q;
+    do {
+        m12 = m1 + m2 + rng->Rndm() * (massMot - m1 - m2 - m3);
+        p3 = TwoBodyMomentum(massMot, m12, m3);
+        q = TwoBodyMomentum(m12, m1, m2);
+    } while (rng->Rndm() * weightMax > p3 * q);
+
+    // dau3 and the (dau1, dau2) system in the rest frame of the mother
+    double phi = rng->Rndm() * 2 * M_PI;
+    double cosTheta = 2 * rng->Rndm() - 1, sinTheta = sqrt(1 - cosTheta * cosTheta);
+    const double p3x = p3 * sinTheta * cos(phi), p3y = p3 * sinTheta * sin(phi), p3z = p3 * cosTheta;
+    dau3.SetP(p3x, p3y, p3z);
+    const double e12 = sqrt(m12 * m12 + p3 * p3);
+
+    // dau1 and dau2 in the rest frame of the system, boosted to that of the mother
+    phi = rng->Rndm() * 2 * M_PI;
+    cosTheta = 2 * rng->Rndm() - 1;
+    sinTheta = sqrt(1 - cosTheta * cosTheta);
+    dau1.SetP(q * sinTheta * cos(phi), q * sinTheta * sin(phi), q * cosTheta);
+    dau2.SetP(-dau1.fPx, -dau1.fPy, -dau1.fPz);
+    dau1.Boost(-p3x / e12, -p3y / e12, -p3z / e12, sqrt(m1 * m1 + q * q));
+    dau2.Boost(-p3x / e12, -p3y / e12, -p3z / e12, sqrt(m2 * m2 + q * q));
+
+    // All three to the laboratory frame
+    const double energy = sqrt(fPx * fPx + fPy * fPy + fPz * fPz + massMot * massMot);
+    const double bx = fPx / energy, by = fPy / energy, bz = fPz / energy;
     dau1.Boost(bx, by, bz);
     dau2.Boost(bx, by, bz);
+    dau3.Boost(bx, by, bz);
 
     return 0;
 }
 
+// Decay the n particles at positions mothers of the particles array in the pairs at
+// positions dau1 and dau2, whose types must be already set. The result is the same as
+// calling Decay2Body on each mother in turn with the same generator, but every step is
+// done for all mothers before the next one, in loops over contiguous arrays that the
+// compiler vectorizes (square roots and boosts; sin and cos remain libm calls, which
+// keeps the result identical to the scalar path). Returns the number of failed decays
+int Particle::Decay2Body(Particle *particles, const int *mothers, const int *dau1, const int *dau2, int n, PhiloxRandom *rng) {
+    // Mothers are processed in groups, with the intermediate values on the stack
+    const int groupSize = 64;
+    double u[3 * groupSize];
+    double px[groupSize], py[groupSize], pz[groupSize], massMot[groupSize], massDau1[groupSize], massDau2[groupSize];
+    double sinTheta[groupSize], cosTheta[groupSize], sinPhi[groupSize], cosPhi[groupSize];
+    double e1[groupSize], e2[groupSize], bx[groupSize], by[groupSize], bz[groupSize];
+    double out[6 * groupSize];
+    bool ok[groupSize];
+
+    int nFailed = 0;
+    for (int first = 0; first < n; first += groupSize) {
+        const int m = min(groupSize, n - first);
+
+        // Three numbers per mother, in the order the scalar path draws them: one for the
+        // mass from the lineshape, then phi and theta
+        rng->Uniforms(u, 3 * m);
+
+        for (int k = 0; k < m; k++) {
+            const Particle &mother = particles[mothers[first + k]];
+            px[k] = mother.fPx;
+            py[k] = mother.fPy;
+            pz[k] = mother.fPz;
+            ok[k] = mother.GetMass() != 0.0;
+            massMot[k] = SampleMass(mother.fIndex, u[3 * k]);
+            massDau1[k] = particles[dau1[first + k]].GetMass();
+            massDau2[k] = particles[dau2[first + k]].GetMass();
+            sinPhi[k] = sin(u[3 * k + 1] * (2 * M_PI));
+            cosPhi[k] = cos(u[3 * k + 1] * (2 * M_PI));
+            const double theta = u[3 * k + 2] * (2 * M_PI) * 0.5 - M_PI / 2.;
+            sinTheta[k] = sin(theta);
+            cosTheta[k] = cos(theta);
+        }
+
+        for (int k = 0; k < m; k++) {
+            if (!ok[k])
+                printf("Decayment cannot be preformed if mass is zero\n");
+            else if (massMot[k] < massDau1[k] + massDau2[k]) {
+                printf("Decayment cannot be preformed because mass is too low in this channel\n");
+                ok[k] = false;
+            }
+            nFailed += !ok[k];
+        }
+
+        // Breakup momenta, then back-to-back daughters with their energies in the rest
+        // frame, boosted to the laboratory frame
+        for (int k = 0; k < m; k++) {
+            const double M = massMot[k], m1 = massDau1[k], m2 = massDau2[k];
+            const double pout = sqrt((M * M - (m1 + m2) * (m1 + m2)) * (M * M - (m1 - m2) * (m1 - m2))) / M * 0.5;
+            e1[k] = sqrt(m1 * m1 + pout * pout);
+            e2[k] = sqrt(m2 * m2 + pout * pout);
+            const double energy = sqrt(px[k] * px[k] + py[k] * py[k] + pz[k] * pz[k] + M * M);
+            bx[k] = px[k] / energy;
+            by[k] = py[k] / energy;
+            bz[k] = pz[k] / energy;
+            out[6 * k] = pout * sinTheta[k] * cosPhi[k];
+            out[6 * k + 1] = pout * sinTheta[k] * sinPhi[k];
+            out[6 * k + 2] = pout * cosTheta[k];
+        }
+        for (int k = 0; k < m; k++) {
+            const double qx = out[6 * k], qy = out[6 * k + 1], qz = out[6 * k + 2];
+            const double b2 = bx[k] * bx[k] + by[k] * by[k] + bz[k] * bz[k];
+            const double gamma = 1.0 / sqrt(1.0 - b2);
+            const double gamma2 = b2 > 0 ? (gamma - 1.0) / b2 : 0.0;
+            const double bp1 = bx[k] * qx + by[k] * qy + bz[k] * qz;
+            const double bp2 = bx[k] * -qx + by[k] * -qy + bz[k] * -qz;
+            out[6 * k] = qx + (gamma2 * bp1 * bx[k] + gamma * bx[k] * e1[k]);
+            out[6 * k + 1] = qy + (gamma2 * bp1 * by[k] + gamma * by[k] * e1[k]);
+            out[6 * k + 2] = qz + (gamma2 * bp1 * bz[k] + gamma * bz[k] * e1[k]);
+            out[6 * k + 3] = -qx + (gamma2 * bp2 * bx[k] + gamma * bx[k] * e2[k]);
+            out[6 * k + 4] = -qy + (gamma2 * bp2 * by[k] + gamma * by[k] * e2[k]);
+            out[6 * k + 5] = -qz + (gamma2 * bp2 * bz[k] + gamma * bz[k] * e2[k]);
+        }
+
+        for (int k = 0; k < m; k++) {
+            if (!ok[k])
+                continue;
+            particles[dau1[first + k]].SetP(out[6 * k], out[6 * k + 1], out[6 * k + 2]);
+            particles[dau2[first + k]].SetP(out[6 * k + 3], out[6 * k + 4], out[6 * k + 5]);
+        }
+    }
+    return nFailed;
+}
+
 void Particle::Boost(double bx, double by, double bz) {
-    double energy = TotEnergy();
+    Boost(bx, by, bz, TotEnergy());
+}
 
-    // Boost this Lorentz vector
+// Boost this Lorentz vector, of the given energy
+void Particle::Boost(double bx, double by, double bz, double energy) {
     double b2 = bx * bx + by * by + bz * bz;
     double gamma = 1.0 / sqrt(1.0 - b2);
     double bp = bx * fPx + by * fPy + bz * fPz;
@@ -180,4 +538,4 @@ void Particle::Boost(double bx, double by, double bz) {
     fPx += gamma2 * bp * bx + gamma * bx * energy;
     fPy += gamma2 * bp * by + gamma * by * energy;
     fPz += gamma2 * bp * bz + gamma * bz * energy;
-}
\ No newline at end of file
+}
@@ -1,4 +1,10 @@
 #include "ParticleType.h"
+#include "PhiloxRandom.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <TRandom.h>
 
 #ifndef PARTICLE_H
 #define PARTICLE_H
@@ -22,21 +28,70 @@ class Particle {
         double InvMass(Particle *p) const;
         void SetP(double Px, double Py, double Pz);
         int Decay2Body(Particle &dau1, Particle &dau2) const;
+        int Decay2Body(Particle &dau1, Particle &dau2, TRandom *rng) const;
+        int Decay3Body(Particle &dau1, Particle &dau2, Particle &dau3, TRandom *rng) const;
+        void Boost(double bx, double by, double bz);
+
+        static int Decay2Body(Particle *particles, const int *mothers, const int *dau1, const int *dau2, int n, PhiloxRandom *rng);
 
-        static void AddParticleType(string particleName, const double mass, const int charge, const double width = 0);
+        static void AddParticleType(string particleName, const double mass, const int charge, const double width = 0, const double abundance = 0);
+        static bool AddDecayChannel(string parentName, const double branchingRatio, const vector<string> &daughterNames);
+        static bool ReadParticleTypes(const string fileName);
+        static bool SetMassAndWidth(const string particleName, const double mass, const double width);
         static void PrintParticleTypes();
+        static int GetNParticleTypes();
+        static const ParticleType *GetParticleType(int index);
+        static int FindParticle(const string &particleName);
+
+        // Properties by species id, from flat arrays and without virtual calls, for hot code
+        static double GetMass(int index) { return fMasses[index]; }
+        static double GetWidth(int index) { return fWidths[index]; }
+        static int GetCharge(int index) { return fCharges[index]; }
+        static double GetAbundance(int index) { return fAbundances[index]; }
+        static int GetNDecayChannels(int index) { return fNChannels[index]; }
+        static int SampleDecayChannel(int index, double u);
+        static int GetNDaughters(int channel) { return fChannelNDaughters[channel]; }
+        static const int *GetDaughters(int channel) { return &fChannelDaughters[fChannelFirstDaughter[channel]]; }
+
+        // Mass of a particle of the given type for a uniform random number u in [0, 1): the
+        // nominal mass for stable types, a relativistic Breit-Wigner for resonances, sampled
+        // by linear interpolation in its tabulated inverse cumulative distribution
+        static double SampleMass(int index, double u) {
+            const int first = fLineshapeFirst[index];
+            if (first < 0)
+                return fMasses[index];
+            const double x = u * (fLineshapeSize - 1);
+            const int i = (int) x;
+            const double *table = &fLineshapes[first];
+            return table[i] + (x - i) * (table[i + 1] - table[i]);
+        }
+
+        static const int fLineshapeSize = 1025;
 
     private:
         int fIndex;
         double fPx, fPy, fPz;
 
-        static const int fMaxNumParticleType = 10;
-        static const ParticleType *fParticleType[];
-        static int fNParticleType;
+        static vector<const ParticleType *> fParticleType;
+        static unordered_map<string, int> fIndexByName;
+        static vector<double> fMasses, fWidths, fAbundances;
+        static vector<int> fCharges;
 
-        static int FindParticle(string particleName);
+        // Decay channels of species i are fFirstChannel[i] ... fFirstChannel[i] + fNChannels[i] - 1,
+        // stored with their cumulative branching ratios and their daughters in flat arrays
+        static vector<int> fFirstChannel, fNChannels;
+        static vector<double> fChannelCumulative;
+        static vector<int> fChannelFirstDaughter, fChannelNDaughters, fChannelDaughters;
 
-        void Boost(double bx, double by, double bz);
+        // Inverse cumulative distributions of the masses of the resonances, fLineshapeSize
+        // values from fLineshapeFirst[i] (-1 for stable types)
+        static vector<int> fLineshapeFirst;
+        static vector<double> fLineshapes;
+
+        static double GetThreshold(int channel);
+        static void BuildLineshape(int index);
+
+        void Boost(double bx, double by, double bz, double energy);
 };
 
 #endif
\ No newline at end of file
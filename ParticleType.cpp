@@ -4,7 +4,7 @@
 
 using namespace std;
 
-string ParticleType::GetName() const {
+const string &ParticleType::GetName() const {
     return fName;
 }
 
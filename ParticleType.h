@@ -7,7 +7,7 @@ class ParticleType {
     public:
         ParticleType(const string name, const double mass, const int charge) :
             fName(name), fMass(mass), fCharge(charge) {}
-        string GetName() const;
+        const string &GetName() const;
         double GetMass() const;
         int GetCharge() const;
         virtual double GetWidth() const;
@@ -0,0 +1,133 @@
+#include "PhiloxRandom.h"
+
+#include <cmath>
+
+using namespace std;
+
+PhiloxRandom::PhiloxRandom(ULong64_t seed) {
+    SetSeed(seed);
+}
+
+// Select the sequence of streams, every stream restarts
+void PhiloxRandom::SetSeed(ULong_t seed) {
+    fSeed = seed;
+    fKey[0] = (UInt_t) seed;
+    fKey[1] = (UInt_t) ((ULong64_t) seed >> 32);
+    SetStream(0);
+}
+
+// Move to the beginning of the given stream
+void PhiloxRandom::SetStream(ULong64_t stream) {
+    fStream = stream;
+    fCounter = 0;
+    fNCached = 0;
+}
+
+ULong64_t PhiloxRandom::GetStream() const {
+    return fStream;
+}
+
+// The ten Philox rounds on one 128-bit counter
+static inline void Philox(UInt_t &c0, UInt_t &c1, UInt_t &c2, UInt_t &c3, UInt_t k0, UInt_t k1) {
+    const UInt_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const UInt_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; round++) {
+        const ULong64_t p0 = (ULong64_t) M0 * c0;
+        const ULong64_t p1 = (ULong64_t) M1 * c2;
+        c0 = (UInt_t) (p1 >> 32) ^ c1 ^ k0;
+        c1 = (UInt_t) p1;
+        c2 = (UInt_t) (p0 >> 32) ^ c3 ^ k1;
+        c3 = (UInt_t) p0;
+        k0 += W0;
+        k1 += W1;
+    }
+}
+
+// 53 random bits per number, shifted by half a step to exclude 0 and 1
+static inline double ToUniform(UInt_t high, UInt_t low) {
+    return ((double) ((((ULong64_t) high << 32) | low) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Two uniform numbers in (0, 1) from the 128 random bits of the given block of the stream
+void PhiloxRandom::Block(ULong64_t counter, double *out) const {
+    UInt_t c0 = (UInt_t) counter, c1 = (UInt_t) (counter >> 32);
+    UInt_t c2 = (UInt_t) fStream, c3 = (UInt_t) (fStream >> 32);
+    Philox(c0, c1, c2, c3, fKey[0], fKey[1]);
+    out[0] = ToUniform(c0, c1);
+    out[1] = ToUniform(c2, c3);
+}
+
+Double_t PhiloxRandom::Rndm() {
+    if (fNCached == 0) {
+        Block(fCounter++, fCache);
+        fNCached = 2;
+    }
+    return fCache[2 - fNCached--];
+}
+
+void PhiloxRandom::RndmArray(Int_t n, Double_t *array) {
+    Uniforms(array, n);
+}
+
+// Same numbers as n calls of Rndm, scaled to [min, max)
+void PhiloxRandom::Uniforms(double *out, int n, double min, double max) {
+    int i = 0;
+    for (; i < n && fNCached > 0; i++)
+        out[i] = Rndm();
+
+    // Blocks are independent, so groups of them are computed side by side in vector lanes
+    const int nLanes = 8;
+    for (; i + 2 * nLanes <= n; i += 2 * nLanes) {
+        UInt_t c0[nLanes], c1[nLanes], c2[nLanes], c3[nLanes];
+        for (int l = 0; l < nLanes; l++) {
+            c0[l] = (UInt_t) (fCounter + l);
+            c1[l] = (UInt_t) ((fCounter + l) >> 32);
+            c2[l] = (UInt_t) fStream;
+            c3[l] = (UInt_t) (fStream >> 32);
+        }
+        for (int l = 0; l < nLanes; l++)
+            Philox(c0[l], c1[l], c2[l], c3[l], fKey[0], fKey[1]);
+        for (int l = 0; l < nLanes; l++) {
+            out[i + 2 * l] = ToUniform(c0[l], c1[l]);
+            out[i + 2 * l + 1] = ToUniform(c2[l], c3[l]);
+        }
+        fCounter += nLanes;
+    }
+    for (; i + 2 <= n; i += 2)
+        Block(fCounter++, out + i);
+    for (; i < n; i++)
+        out[i] = Rndm();
+
+    if (min != 0 || max != 1)
+        for (i = 0; i < n; i++)
+            out[i] = min + (max - min) * out[i];
+}
+
+Double_t PhiloxRandom::Exp(Double_t tau) {
+    return -tau * log(Rndm());
+}
+
+void PhiloxRandom::Exponentials(double *out, int n, double tau) {
+    Uniforms(out, n);
+    for (int i = 0; i < n; i++)
+        out[i] = -tau * log(out[i]);
+}
+
+// Box-Muller transform: always two uniform numbers per gaussian, so that the position in
+// the stream does not depend on the values drawn as with rejection methods
+Double_t PhiloxRandom::Gaus(Double_t mean, Double_t sigma) {
+    const double u1 = Rndm();
+    const double u2 = Rndm();
+    return mean + sigma * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+void PhiloxRandom::Gaussians(double *out, int n, double mean, double sigma) {
+    double u[2 * fBatchSize];
+    for (int begin = 0; begin < n; begin += fBatchSize) {
+        const int m = n - begin < fBatchSize ? n - begin : fBatchSize;
+        Uniforms(u, 2 * m);
+        for (int i = 0; i < m; i++)
+            out[begin + i] = mean + sigma * sqrt(-2 * log(u[2 * i])) * cos(2 * M_PI * u[2 * i + 1]);
+    }
+}
@@ -0,0 +1,42 @@
+#include <TRandom.h>
+
+#ifndef PHILOX_RANDOM_H
+#define PHILOX_RANDOM_H
+
+using namespace std;
+
+// Counter-based random generator (Philox4x32-10, Salmon et al., SC11). The n-th number of
+// a stream is a pure function of (seed, stream, n), so each event draws from its own
+// stream, independent of the thread and of the order events are simulated in, and a
+// single event can be reproduced alone. Being a TRandom it can be passed to any code
+// taking a generator; numbers can also be drawn in batches, which are much cheaper than
+// single calls
+class PhiloxRandom : public TRandom {
+    public:
+        PhiloxRandom(ULong64_t seed = 4357);
+        void SetSeed(ULong_t seed = 0) override;
+        void SetStream(ULong64_t stream);
+        ULong64_t GetStream() const;
+
+        Double_t Rndm() override;
+        void RndmArray(Int_t n, Double_t *array) override;
+        Double_t Exp(Double_t tau) override;
+        Double_t Gaus(Double_t mean = 0, Double_t sigma = 1) override;
+
+        void Uniforms(double *out, int n, double min = 0, double max = 1);
+        void Exponentials(double *out, int n, double tau);
+        void Gaussians(double *out, int n, double mean = 0, double sigma = 1);
+
+        static const int fBatchSize = 1024;
+
+    private:
+        UInt_t fKey[2];
+        ULong64_t fStream;
+        ULong64_t fCounter;     // Next block of the stream
+        double fCache[2];       // Unused numbers of the last block
+        int fNCached;
+
+        void Block(ULong64_t counter, double *out) const;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "Profiler.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+Profiler Profiler::fTotal;
+mutex Profiler::fMutex;
+
+static const char *const STAGE_NAMES[Profiler::fNStages] = {
+    "run", "sampling", "fills", "decays", "pairs", "pairFills", "mixing", "merge", "write", "read", "fits", "plots"
+};
+
+// Stage whose time includes that of the given one, -1 for none
+static const int STAGE_PARENTS[Profiler::fNStages] = {
+    -1, -1, -1, -1, -1, Profiler::kPairs, -1, -1, -1, -1, -1, -1
+};
+
+static const char *const COUNTER_NAMES[Profiler::kPairsFilled] = {
+    "events", "particles", "decayedResonances", "failedDecays", "pairsEvaluated"
+};
+
+Profiler::Profiler() {
+    Reset();
+}
+
+void Profiler::Reset() {
+    for (int i = 0; i < fNStages; i++)
+        fTimes[i] = 0;
+    for (int i = 0; i < fNCounters; i++)
+        fCounts[i] = 0;
+}
+
+// Profile of the calling thread
+Profiler &Profiler::Local() {
+    thread_local Profiler profiler;
+    return profiler;
+}
+
+// Add the profile of the calling thread to the total and clear it. Threads call it when done
+void Profiler::Collect() {
+    Profiler &local = Local();
+    lock_guard<mutex> lock(fMutex);
+    for (int i = 0; i < fNStages; i++)
+        fTotal.fTimes[i] += local.fTimes[i];
+    for (int i = 0; i < fNCounters; i++)
+        fTotal.fCounts[i] += local.fCounts[i];
+    local.Reset();
+}
+
+// Profile as a JSON object on one line
+string Profiler::ToJson(const string name) const {
+    stringstream json;
+    json.precision(6);
+    json << "{\"name\": \"" << name << "\", \"seconds\": {";
+    for (int i = 0; i < fNStages; i++)
+        json << (i > 0 ? ", " : "") << "\"" << STAGE_NAMES[i] << "\": " << fTimes[i];
+    json << "}, \"counters\": {";
+    for (int i = 0; i < kPairsFilled; i++)
+        json << (i > 0 ? ", " : "") << "\"" << COUNTER_NAMES[i] << "\": " << fCounts[i];
+    json << "}, \"pairsFilled\": {";
+    const Histograms histograms;
+    for (int id = 0; id < Histograms::fNHistograms; id++)
+        json << (id > 0 ? ", " : "") << "\"" << histograms.Get(id)->GetName() << "\": " << fCounts[kPairsFilled + id];
+    json << "}, \"eventsPerSecond\": " << (fTimes[kRun] > 0 ? fCounts[kEvents] / fTimes[kRun] : 0) << "}";
+    return json.str();
+}
+
+// Print the total profile of the threads done since the last report, named name, and
+// append it in JSON to jsonFileName unless empty, one line per report, then clear it
+void Profiler::Report(const string name, const string jsonFileName) {
+    Collect();
+    lock_guard<mutex> lock(fMutex);
+
+    // Stages other than kRun share the thread time, nested ones are shown under their parent
+    double threadSeconds = 0;
+    for (int i = kRun + 1; i < fNStages; i++) {
+        if (STAGE_PARENTS[i] < 0)
+            threadSeconds += fTotal.fTimes[i];
+    }
+    std::cout << "Profile of " << name << ":" << std::endl;
+    if (fTotal.fTimes[kRun] > 0)
+        std::cout << "\t" << STAGE_NAMES[kRun] << ": " << fTotal.fTimes[kRun] << " s, " << fTotal.fCounts[kEvents] / fTotal.fTimes[kRun] << " events/s" << std::endl;
+    for (int i = kRun + 1; i < fNStages; i++) {
+        if (fTotal.fTimes[i] > 0)
+            std::cout << (STAGE_PARENTS[i] < 0 ? "\t" : "\t\t") << STAGE_NAMES[i] << ": " << fTotal.fTimes[i] << " s (" << 100 * fTotal.fTimes[i] / threadSeconds << "%)" << std::endl;
+    }
+    for (int i = 0; i < kPairsFilled; i++)
+        std::cout << "\t" << COUNTER_NAMES[i] << ": " << fTotal.fCounts[i] << std::endl;
+    const Histograms histograms;
+    for (int id = 0; id < Histograms::fNHistograms; id++) {
+        if (fTotal.fCounts[kPairsFilled + id] > 0)
+            std::cout << "\tpairs in " << histograms.Get(id)->GetName() << ": " << fTotal.fCounts[kPairsFilled + id] << std::endl;
+    }
+
+    if (!jsonFileName.empty()) {
+        ofstream file(jsonFileName, ios::app);
+        file << fTotal.ToJson(name) << endl;
+        if (!file)
+            std::cout << "Cannot write the profile in " << jsonFileName << std::endl;
+    }
+    fTotal.Reset();
+}
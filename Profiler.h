@@ -0,0 +1,77 @@
+#include "Histograms.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+using namespace std;
+
+// Instrumentation of generation and analysis: time spent in each stage, summed over the
+// threads, and counters of events, pairs and decays. Each thread accumulates in its own
+// profile, added to the total by Collect, so nothing is shared while events are generated.
+// It is compiled in only with PROFILING defined (cmake -DPROFILING=ON): otherwise the
+// PROFILE_ macros expand to nothing and the instrumented code is the plain one
+class Profiler {
+    public:
+        // Stages timed; kRun is the wall time of the event loop, the others are summed over
+        // threads. kPairFills, the invariant mass fills, is part of kPairs
+        enum Stage { kRun, kSampling, kFills, kDecays, kPairs, kPairFills, kMixing, kMerge, kWrite, kRead, kFits, kPlots, fNStages };
+
+        // Counters; kPairsFilled is followed by one counter per histogram id (see Histograms)
+        enum Counter { kEvents, kParticles, kDecayedResonances, kFailedDecays, kPairsEvaluated, kPairsFilled, fNCounters = kPairsFilled + Histograms::fNHistograms };
+
+        Profiler();
+        void AddTime(int stage, double seconds) { fTimes[stage] += seconds; }
+        void Add(int counter, long long n) { fCounts[counter] += n; }
+
+        static Profiler &Local();
+        static void Collect();
+        static void Report(const string name, const string jsonFileName);
+
+    private:
+        double fTimes[fNStages];
+        long long fCounts[fNCounters];
+
+        void Reset();
+        string ToJson(const string name) const;
+
+        static Profiler fTotal;
+        static mutex fMutex;
+};
+
+// Adds the time from its construction to Stop, or to its destruction, to a stage of the
+// profile of the calling thread
+class ScopedTimer {
+    public:
+        ScopedTimer(int stage) : fStage(stage), fStart(chrono::steady_clock::now()) {}
+        ~ScopedTimer() { Stop(); }
+        void Stop() {
+            if (fStage < 0)
+                return;
+            Profiler::Local().AddTime(fStage, chrono::duration<double>(chrono::steady_clock::now() - fStart).count());
+            fStage = -1;
+        }
+
+    private:
+        int fStage;
+        chrono::steady_clock::time_point fStart;
+};
+
+#ifdef PROFILING
+#define PROFILE_SCOPE(stage) ScopedTimer profile_##stage(Profiler::stage)
+#define PROFILE_STOP(stage) profile_##stage.Stop()
+#define PROFILE_COUNT(counter, n) Profiler::Local().Add(counter, n)
+#define PROFILE_COLLECT() Profiler::Collect()
+#define PROFILE_REPORT(name) Profiler::Report(name, gConfig.profileFile)
+#else
+#define PROFILE_SCOPE(stage) ((void) 0)
+#define PROFILE_STOP(stage) ((void) 0)
+#define PROFILE_COUNT(counter, n) ((void) sizeof(n))
+#define PROFILE_COLLECT() ((void) 0)
+#define PROFILE_REPORT(name) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+#include "RebuildHistograms.h"
+
+#include "EventStore.h"
+#include "GenerateParticles.h"
+#include "Histograms.h"
+#include "PairTable.h"
+
+#include <iostream>
+#include <TFile.h>
+
+using namespace std;
+
+// Rebuild the generation histograms from an event file written by GenerateParticles,
+// with the binning and pair selections currently set in gConfig and PairTable, and save
+// them in outputFileName
+bool RebuildHistograms(const char *eventsFileName, const char *outputFileName, int nThreads) {
+    if (!InitParticleTypes())
+        return false;
+
+    EventStoreReader reader(eventsFileName);
+    if (!reader.IsOpen())
+        return false;
+    std::cout << "Reading " << reader.GetNEvents() << " events from " << eventsFileName << std::endl;
+
+    const PairTable pairTable;
+    Histograms histograms;
+    reader.FillHistograms(histograms, pairTable, EventStoreReader::fAllHistograms, nThreads);
+
+    TFile *file = new TFile(outputFileName, "RECREATE");
+    histograms.Write();
+    file->Close();
+    delete file;
+    return true;
+}
@@ -0,0 +1,8 @@
+#ifndef REBUILD_HISTOGRAMS_H
+#define REBUILD_HISTOGRAMS_H
+
+using namespace std;
+
+bool RebuildHistograms(const char *eventsFileName = "events.bin", const char *outputFileName = "histograms.root", int nThreads = 1);
+
+#endif
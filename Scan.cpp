@@ -0,0 +1,182 @@
+#include "Scan.h"
+
+#include "AnalyzeData.h"
+#include "Config.h"
+#include "GenerateParticles.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+typedef vector<pair<string, string>> ScanPoint;
+
+// Read the points of a scan. Each line lists "key=value" parameters, separated by spaces,
+// and gives one point, or a grid of points if values list alternatives separated by "|":
+//     width:K*=0.040|0.050|0.060 multiplicity=fixed|poisson
+// gives six points. # starts a comment
+static bool ReadScan(const string fileName, vector<ScanPoint> &points) {
+    ifstream file(fileName.c_str());
+    if (!file) {
+        std::cout << "Cannot open scan file " << fileName << std::endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        stringstream stream(line.substr(0, line.find('#')));
+        vector<string> keys;
+        vector<vector<string>> values;
+        string item;
+        while (stream >> item) {
+            const size_t equal = item.find('=');
+            if (equal == string::npos) {
+                std::cout << fileName << ":" << lineNumber << ": expected key=value, got " << item << std::endl;
+                return false;
+            }
+            keys.push_back(item.substr(0, equal));
+            values.push_back(vector<string>());
+            stringstream alternatives(item.substr(equal + 1));
+            string value;
+            while (getline(alternatives, value, '|'))
+                values.back().push_back(value);
+            if (values.back().empty())
+                values.back().push_back("");
+        }
+        if (keys.empty())
+            continue;
+
+        // Grid of the alternatives, the last key varying fastest
+        vector<size_t> choice(keys.size(), 0);
+        for (bool done = false; !done; ) {
+            ScanPoint point;
+            for (size_t k = 0; k < keys.size(); k++)
+                point.push_back(make_pair(keys[k], values[k][choice[k]]));
+            points.push_back(point);
+            int k = keys.size() - 1;
+            while (k >= 0 && ++choice[k] == values[k].size())
+                choice[k--] = 0;
+            done = k < 0;
+        }
+    }
+    return true;
+}
+
+static string PointFileName(const string stem, int i, const string extension) {
+    stringstream name;
+    name << stem << "_" << i << extension;
+    return name.str();
+}
+
+// Generate and summarize a point of the scan, in a worker process: the output of the
+// run goes to its log file and its summary line to its summary file
+static int RunPoint(const string stem, int i, const ScanPoint &point) {
+    if (!freopen(PointFileName(stem, i, ".log").c_str(), "w", stdout))
+        return 1;
+    for (const pair<string, string> &parameter : point)
+        if (!gConfig.Set(parameter.first, parameter.second))
+            return 1;
+    if (!gConfig.CheckRanges())
+        return 1;
+    gConfig.histogramsFile = PointFileName(stem, i, ".root");
+    gConfig.checkpointFile = PointFileName(stem, i, ".checkpoint.root");
+    if (!InitParticleTypes())
+        return 1;
+
+    GenerateParticles(gConfig.nThreads, gConfig.seed, gConfig.eventsFile.empty() ? 0 : PointFileName(stem, i, ".bin").c_str());
+
+    RunSummary summary;
+    if (!SummarizeRun(gConfig.histogramsFile, summary))
+        return 1;
+    ofstream out(PointFileName(stem, i, ".summary").c_str());
+    out << summary.kStarMass << "\t" << summary.kStarMassError << "\t" << summary.kStarWidth << "\t" << summary.kStarWidthError << "\t" <<
+           summary.daughtersMass << "\t" << summary.daughtersMassError << "\t" << summary.daughtersWidth << "\t" << summary.daughtersWidthError << "\t" <<
+           summary.nChecks - summary.nFailedChecks << "/" << summary.nChecks << std::endl;
+    return out ? 0 : 1;
+}
+
+// Run all the points of the scan in scanFileName, up to nJobs at a time. The particle catalog
+// and the parameters are global to a process, so each point runs in a worker process of
+// its own, forked from this one with the parameters as they are now and then changed by
+// the point. Point i writes <stem>_i.root and <stem>_i.log, where <stem> is the scan file
+// name without extension, and the table of all the points goes to <stem>_summary.txt
+bool RunScan(const string scanFileName, int nJobs) {
+    vector<ScanPoint> points;
+    if (!ReadScan(scanFileName, points))
+        return false;
+    const size_t dot = scanFileName.find_last_of('.');
+    const size_t slash = scanFileName.find_last_of('/');
+    const string stem = dot != string::npos && (slash == string::npos || dot > slash) ? scanFileName.substr(0, dot) : scanFileName;
+    if (nJobs < 1)
+        nJobs = 1;
+    std::cout << "Scanning " << points.size() << " points, " << nJobs << " at a time" << std::endl;
+
+    // Pool of workers: a new point starts as soon as one finishes
+    map<pid_t, int> running;
+    vector<int> status(points.size(), -1);
+    size_t next = 0;
+    while (next < points.size() || !running.empty()) {
+        while (next < points.size() && (int) running.size() < nJobs) {
+            std::cout.flush();
+            fflush(stdout);
+            const pid_t pid = fork();
+            if (pid == 0) {
+                // _exit skips the flush of stdout, which is fully buffered once redirected to the log
+                const int result = RunPoint(stem, next, points[next]);
+                std::cout.flush();
+                fflush(stdout);
+                _exit(result);
+            }
+            if (pid < 0) {
+                std::cout << "Cannot start a worker process for point " << next << std::endl;
+                status[next] = 1;
+            } else
+                running[pid] = next;
+            next++;
+        }
+        if (running.empty())
+            continue;
+
+        int waitStatus;
+        const pid_t pid = wait(&waitStatus);
+        if (pid < 0 || running.count(pid) == 0)
+            continue;
+        const int i = running[pid];
+        running.erase(pid);
+        status[i] = WIFEXITED(waitStatus) ? WEXITSTATUS(waitStatus) : 1;
+        std::cout << "Point " << i << (status[i] == 0 ? " done" : " failed, see its log") << std::endl;
+    }
+
+    // Summary table, one line per point
+    const string summaryFileName = stem + "_summary.txt";
+    ofstream summary(summaryFileName.c_str());
+    summary << "point\tkStarMass\tkStarMassError\tkStarWidth\tkStarWidthError\t"
+               "daughtersMass\tdaughtersMassError\tdaughtersWidth\tdaughtersWidthError\tchecks\tparameters" << std::endl;
+    int nFailed = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+        string line;
+        ifstream pointSummary(PointFileName(stem, i, ".summary").c_str());
+        if (status[i] != 0 || !getline(pointSummary, line)) {
+            line = "-\t-\t-\t-\t-\t-\t-\t-\tfailed";
+            nFailed++;
+        }
+        summary << i << "\t" << line << "\t";
+        for (size_t k = 0; k < points[i].size(); k++)
+            summary << (k > 0 ? " " : "") << points[i][k].first << "=" << points[i][k].second;
+        summary << std::endl;
+        pointSummary.close();
+        remove(PointFileName(stem, i, ".summary").c_str());
+    }
+    std::cout << "Summary saved in " << summaryFileName << std::endl;
+    return nFailed == 0;
+}
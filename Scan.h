@@ -0,0 +1,10 @@
+#include <string>
+
+#ifndef SCAN_H
+#define SCAN_H
+
+using namespace std;
+
+bool RunScan(const string scanFileName, int nJobs);
+
+#endif
@@ -0,0 +1,435 @@
+#include "Checks.h"
+#include "Config.h"
+#include "EventBuffer.h"
+#include "FixedHistogram.h"
+#include "GenerateParticles.h"
+#include "Histograms.h"
+#include "PairTable.h"
+#include "Particle.h"
+#include "Parameters.h"
+#include "PhiloxRandom.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <TH1.h>
+#include <TRandom3.h>
+
+using namespace std;
+
+// Differential validation of the optimized paths against the reference ones. Kernels are run
+// on identical seeded inputs and compared value by value: invariant masses of EventBuffer
+// against Particle::InvMass, batched against scalar Decay2Body, SetPrimaries against the
+// plain trigonometric formulas and FixedHistogram against TH1D. Then whole histograms of
+// GenerateEvents, unweighted and importance weighted, are compared with chi2 and
+// Kolmogorov-Smirnov tests against those of a scalar reference generator, one Particle at a
+// time with TRandom3, and checked with the rules of Checks, also with Poisson multiplicity.
+// The exit status is the number of failed comparisons. Run parameters are read as in the
+// main executable (--key=value, --config=file)
+
+static const int N_KERNEL_EVENTS = 200;         // Events of random particles compared value by value
+static const int N_VALIDATION_EVENTS = 2000;    // Events of each generator compared by histograms
+// Single precision kernels (see Real) round to about 1E-7, amplified near the pair thresholds
+static const double MAX_RELATIVE_DIFFERENCE = sizeof(Real) == sizeof(double) ? 1E-10 : 1E-3;
+static const int N_BATCHES = 20;                // Batches of events estimating the variance of the bins
+static const double MIN_P_VALUE = 1E-3;         // Smallest p-value of the histogram tests accepted
+static const map<string, double> VALIDATION_BIASES = {{"K*", 10}, {"K+", 3}, {"K-", 3}};  // Importance sampling validated
+
+static int gNFailed = 0;
+
+// Print a comparison and count it if failed
+static void Report(const string name, double value, double limit, bool passed) {
+    std::cout << (passed ? "ok      " : "FAILED  ") << name << ": " << value << " (limit " << limit << ")" << std::endl;
+    if (!passed)
+        gNFailed++;
+}
+
+static void ReportDifference(const string name, double maxDifference) {
+    Report(name + ", largest relative difference", maxDifference, MAX_RELATIVE_DIFFERENCE, maxDifference <= MAX_RELATIVE_DIFFERENCE);
+}
+
+static double RelativeDifference(double value, double reference) {
+    return abs(value - reference) / max(abs(reference), 1E-300);
+}
+
+// Random particles of the species of the catalog, with Gaussian momenta
+static void RandomParticles(vector<Particle> &particles, PhiloxRandom &rng) {
+    for (Particle &p : particles) {
+        p.SetIndex((int) (rng.Rndm() * Particle::GetNParticleTypes()));
+        p.SetP(rng.Gaus(), rng.Gaus(), rng.Gaus());
+    }
+}
+
+static void ValidateKernels() {
+    PhiloxRandom rng(gConfig.seed);
+    const int nParticles = gConfig.nParticlesPerIteration;
+    vector<Particle> particles(nParticles), others(nParticles);
+    EventBuffer buffer(nParticles), otherBuffer(nParticles);
+    vector<Real> masses(nParticles);
+
+    // Invariant masses of every pair, within an event and with another event
+    double maxPair = 0, maxRow = 0, maxMixed = 0;
+    for (int event = 0; event < N_KERNEL_EVENTS; event++) {
+        RandomParticles(particles, rng);
+        RandomParticles(others, rng);
+        buffer.Load(particles.data(), nParticles);
+        otherBuffer.Load(others.data(), nParticles);
+        for (int i = 0; i < nParticles; i++) {
+            buffer.InvMasses(i, 0, nParticles, masses.data());
+            for (int k = 0; k < nParticles; k++) {
+                if (k == i)
+                    continue;
+                const double reference = particles[i].InvMass(&particles[k]);
+                maxRow = max(maxRow, RelativeDifference(masses[k], reference));
+                maxPair = max(maxPair, RelativeDifference(buffer.InvMass(i, k), reference));
+            }
+            otherBuffer.InvMasses(buffer.GetE()[i], buffer.GetPx()[i], buffer.GetPy()[i], buffer.GetPz()[i], 0, nParticles, masses.data());
+            for (int k = 0; k < nParticles; k++)
+                maxMixed = max(maxMixed, RelativeDifference(masses[k], particles[i].InvMass(&others[k])));
+        }
+    }
+    ReportDifference("EventBuffer::InvMass", maxPair);
+    ReportDifference("EventBuffer::InvMasses", maxRow);
+    ReportDifference("EventBuffer::InvMasses (mixed events)", maxMixed);
+
+    // Momenta and energies of the primaries
+    vector<int> species(nParticles);
+    vector<double> p(nParticles), theta(nParticles), phi(nParticles), pt(nParticles);
+    double maxPrimary = 0;
+    for (int event = 0; event < N_KERNEL_EVENTS; event++) {
+        for (int i = 0; i < nParticles; i++) {
+            species[i] = (int) (rng.Rndm() * Particle::GetNParticleTypes());
+            p[i] = rng.Exp(gConfig.avgP);
+            theta[i] = rng.Uniform(0, M_PI);
+            phi[i] = rng.Uniform(0, 2 * M_PI);
+        }
+        buffer.SetPrimaries(nParticles, species.data(), p.data(), theta.data(), phi.data(), pt.data());
+        for (int i = 0; i < nParticles; i++) {
+            Particle reference;
+            reference.SetIndex(species[i]);
+            reference.SetP(p[i] * sin(theta[i]) * cos(phi[i]), p[i] * sin(theta[i]) * sin(phi[i]), p[i] * cos(theta[i]));
+            const double values[] = {buffer.GetPx()[i], buffer.GetPy()[i], buffer.GetPz()[i], buffer.GetE()[i], pt[i]};
+            const double references[] = {reference.GetPx(), reference.GetPy(), reference.GetPz(), reference.TotEnergy(), p[i] * sin(theta[i])};
+            for (int c = 0; c < 5; c++)
+                maxPrimary = max(maxPrimary, abs(values[c] - references[c]) / max(reference.TotEnergy(), 1E-300));
+        }
+    }
+    ReportDifference("EventBuffer::SetPrimaries", maxPrimary);
+
+    // Two-body decays of the resonances of the catalog, in channels drawn from their decay
+    // tables, drawing from identical streams
+    vector<Particle> batch;
+    vector<int> mothers, dau1, dau2;
+    for (int i = 0; i < Particle::GetNParticleTypes(); i++) {
+        for (int k = 0; k < N_KERNEL_EVENTS * 10 && Particle::GetNDecayChannels(i) > 0; k++) {
+            const int channel = Particle::SampleDecayChannel(i, rng.Rndm());
+            if (Particle::GetNDaughters(channel) != 2)
+                continue;
+            Particle mother, daughter1, daughter2;
+            mother.SetIndex(i);
+            mother.SetP(rng.Gaus(), rng.Gaus(), rng.Gaus());
+            daughter1.SetIndex(Particle::GetDaughters(channel)[0]);
+            daughter2.SetIndex(Particle::GetDaughters(channel)[1]);
+            mothers.push_back(batch.size());
+            dau1.push_back(batch.size() + 1);
+            dau2.push_back(batch.size() + 2);
+            batch.push_back(mother);
+            batch.push_back(daughter1);
+            batch.push_back(daughter2);
+        }
+    }
+    vector<Particle> scalar = batch;
+    PhiloxRandom batchRng(gConfig.seed), scalarRng(gConfig.seed);
+    const int nBatchFailed = Particle::Decay2Body(batch.data(), mothers.data(), dau1.data(), dau2.data(), mothers.size(), &batchRng);
+    int nScalarFailed = 0;
+    for (size_t k = 0; k < mothers.size(); k++) {
+        if (scalar[mothers[k]].Decay2Body(scalar[dau1[k]], scalar[dau2[k]], &scalarRng) != 0)
+            nScalarFailed++;
+    }
+    double maxDecay = 0;
+    for (size_t i = 0; i < batch.size(); i++) {
+        const double scale = max(1.0, abs(scalar[i].GetPx()) + abs(scalar[i].GetPy()) + abs(scalar[i].GetPz()));
+        maxDecay = max(maxDecay, (abs(batch[i].GetPx() - scalar[i].GetPx()) + abs(batch[i].GetPy() - scalar[i].GetPy()) + abs(batch[i].GetPz() - scalar[i].GetPz())) / scale);
+    }
+    ReportDifference("Particle::Decay2Body (batch)", maxDecay);
+    Report("Particle::Decay2Body (batch), failed decays minus scalar ones", nBatchFailed - nScalarFailed, 0, nBatchFailed == nScalarFailed);
+
+    // Histogram fills
+    FixedHistogram fixed("validationH", "Validation", gConfig.nBinsInvMass, gConfig.minInvariantMass, gConfig.maxInvariantMass);
+    fixed.Sumw2();
+    TH1 *filled = fixed.ToTH1();
+    vector<double> values(nParticles);
+    for (int event = 0; event < N_KERNEL_EVENTS; event++) {
+        for (double &x : values)
+            x = rng.Uniform(gConfig.minInvariantMass - 0.1, gConfig.maxInvariantMass + 0.1);
+        fixed.FillN(nParticles, values.data());
+        for (double x : values)
+            filled->Fill(x);
+    }
+    TH1 *exported = fixed.ToTH1();
+    double maxBin = 0;
+    for (int bin = 0; bin <= gConfig.nBinsInvMass + 1; bin++)
+        maxBin = max(maxBin, abs(exported->GetBinContent(bin) - filled->GetBinContent(bin)) + abs(exported->GetBinError(bin) - filled->GetBinError(bin)));
+    Report("FixedHistogram, largest bin difference from TH1", maxBin, 0, maxBin == 0);
+    const double maxStatistics = max(RelativeDifference(exported->GetMean(), filled->GetMean()), RelativeDifference(exported->GetRMS(), filled->GetRMS()));
+    ReportDifference("FixedHistogram, mean and RMS", maxStatistics);
+    Report("FixedHistogram, entries difference from TH1", exported->GetEntries() - filled->GetEntries(), 0, exported->GetEntries() == filled->GetEntries());
+    delete filled;
+    delete exported;
+}
+
+// Reference generation of nEvents events: the scalar path of the original generator, with
+// TRandom3, a linear search of the cumulative species probabilities, Particle objects decayed
+// one at a time and pairs classified by their charges, filling ROOT histograms directly
+static void GenerateReference(vector<TH1 *> &h, Long64_t nEvents, TRandom3 &rng) {
+    vector<double> cumulative = SpeciesProbabilities();
+    for (size_t i = 1; i < cumulative.size(); i++)
+        cumulative[i] += cumulative[i - 1];
+    const int pionPlus = Particle::FindParticle("π+"), pionMinus = Particle::FindParticle("π-");
+    const int kaonPlus = Particle::FindParticle("K+"), kaonMinus = Particle::FindParticle("K-");
+
+    vector<Particle> particles;
+    vector<int> parents;
+    for (Long64_t event = 0; event < nEvents; event++) {
+        particles.clear();
+        parents.clear();
+        for (int i = 0; i < gConfig.nParticlesPerIteration; i++) {
+            const double phi = rng.Uniform(0, 2 * M_PI);
+            const double theta = rng.Uniform(0, M_PI);
+            const double p = rng.Exp(gConfig.avgP);
+            const double u = rng.Rndm() * cumulative.back();
+            int index = 0;
+            while (index + 1 < (int) cumulative.size() && u >= cumulative[index])
+                index++;
+            Particle particle;
+            particle.SetIndex(index);
+            particle.SetP(p * sin(theta) * cos(phi), p * sin(theta) * sin(phi), p * cos(theta));
+            particles.push_back(particle);
+            parents.push_back(-1);
+            h[Histograms::kParticleTypes]->Fill(index);
+            h[Histograms::kFinalParticleTypes]->Fill(index);
+            h[Histograms::kAzimutAngle]->Fill(phi);
+            h[Histograms::kPolarAngle]->Fill(theta);
+            h[Histograms::kMomentum]->Fill(p);
+            h[Histograms::kTransverseMomentum]->Fill(sqrt(pow(particle.GetPx(), 2) + pow(particle.GetPy(), 2)));
+            h[Histograms::kParticleEnergy]->Fill(particle.TotEnergy());
+        }
+
+        // Resonances decay one generation at a time, daughters are appended
+        for (size_t first = 0, last = particles.size(); first < last; first = last, last = particles.size()) {
+            for (size_t j = first; j < last; j++) {
+                const Particle mother = particles[j];
+                if (Particle::GetNDecayChannels(mother.GetIndex()) == 0)
+                    continue;
+                const int channel = Particle::SampleDecayChannel(mother.GetIndex(), rng.Rndm());
+                const int nDaughters = Particle::GetNDaughters(channel);
+                Particle daughters[3];
+                for (int d = 0; d < nDaughters; d++) {
+                    daughters[d].SetIndex(Particle::GetDaughters(channel)[d]);
+                    h[Histograms::kFinalParticleTypes]->Fill(daughters[d].GetIndex());
+                }
+                if (nDaughters == 2) {
+                    mother.Decay2Body(daughters[0], daughters[1], &rng);
+                    h[Histograms::kDaughtersInvMass]->Fill(daughters[0].InvMass(&daughters[1]));
+                } else if (nDaughters == 3)
+                    mother.Decay3Body(daughters[0], daughters[1], daughters[2], &rng);
+                for (int d = 0; d < nDaughters; d++) {
+                    particles.push_back(daughters[d]);
+                    parents.push_back(j);
+                }
+            }
+        }
+
+        // Pairs of charged stable particles
+        for (size_t j = 0; j < particles.size(); j++) {
+            const int index1 = particles[j].GetIndex(), charge1 = Particle::GetCharge(index1);
+            if (charge1 == 0 || Particle::GetNDecayChannels(index1) > 0)
+                continue;
+            for (size_t k = 0; k < j; k++) {
+                const int index2 = particles[k].GetIndex(), charge2 = Particle::GetCharge(index2);
+                if (charge2 == 0 || Particle::GetNDecayChannels(index2) > 0)
+                    continue;
+                const double mass = particles[j].InvMass(&particles[k]);
+                const bool discordant = charge1 * charge2 < 0;
+                h[Histograms::kInvMass]->Fill(mass);
+                h[discordant ? Histograms::kDiscordantInvMass : Histograms::kConcordantInvMass]->Fill(mass);
+                const bool pion1 = index1 == pionPlus || index1 == pionMinus, kaon1 = index1 == kaonPlus || index1 == kaonMinus;
+                const bool pion2 = index2 == pionPlus || index2 == pionMinus, kaon2 = index2 == kaonPlus || index2 == kaonMinus;
+                if ((pion1 && kaon2) || (kaon1 && pion2))
+                    h[discordant ? Histograms::kDiscordantPionKaonInvMass : Histograms::kConcordantPionKaonInvMass]->Fill(mass);
+            }
+        }
+    }
+}
+
+// Ratio of the variance of the bin contents over batches of independent events to that of
+// independently filled entries, pooled over the bins: 1 for single particles, larger for
+// pairs, which share particles within an event and so fluctuate together. With cumulative,
+// that of the cumulative fractions, which the Kolmogorov-Smirnov test compares and in which
+// pairs are correlated also across bins
+static double Overdispersion(const vector<TH1 *> &batches, bool cumulative) {
+    const int nBins = batches[0]->GetNbinsX();
+    double meanEntries = 0;
+    vector<vector<double> > values(batches.size(), vector<double>(nBins));
+    for (size_t i = 0; i < batches.size(); i++) {
+        double sum = 0;
+        for (int bin = 1; bin <= nBins; bin++) {
+            sum = (cumulative ? sum : 0) + batches[i]->GetBinContent(bin);
+            values[i][bin - 1] = sum;
+        }
+        if (cumulative) {
+            for (double &v : values[i])
+                v /= max(sum, 1.0);
+        }
+        meanEntries += sum / batches.size();
+    }
+    double variance = 0, independentVariance = 0;
+    for (int bin = 0; bin < nBins; bin++) {
+        double sum = 0, sum2 = 0;
+        for (const vector<double> &v : values) {
+            sum += v[bin];
+            sum2 += v[bin] * v[bin];
+        }
+        const double mean = sum / values.size();
+        variance += max(0.0, sum2 - values.size() * mean * mean) / (values.size() - 1);
+        independentVariance += cumulative ? mean * (1 - mean) / max(meanEntries, 1.0) : mean;
+    }
+    return independentVariance > 0 ? max(1.0, variance / independentVariance) : 1;
+}
+
+// Copy of h with the contents divided by overdispersion: the counts of independent entries
+// with the same relative fluctuations, to which the chi2 and Kolmogorov-Smirnov tests apply
+static TH1 *Thinned(TH1 *h, double overdispersion) {
+    TH1 *thinned = (TH1 *) h->Clone((string(h->GetName()) + "Thinned").c_str());
+    thinned->Reset();
+    double entries = 0;
+    for (int bin = 1; bin <= h->GetNbinsX(); bin++) {
+        const double content = h->GetBinContent(bin) / overdispersion;
+        thinned->SetBinContent(bin, content);
+        thinned->SetBinError(bin, sqrt(content));
+        entries += content;
+    }
+    thinned->SetEntries(entries);
+    return thinned;
+}
+
+// Events of a generator in N_BATCHES batches, adding the histograms of each batch to total
+// and keeping them in batches, one vector per histogram id
+template <class Generate>
+static void GenerateBatches(vector<TH1 *> &total, vector<vector<TH1 *> > &batches, Generate generate) {
+    const Histograms empty;
+    total.resize(Histograms::fNHistograms);
+    batches.assign(Histograms::fNHistograms, vector<TH1 *>());
+    for (int id = 0; id < Histograms::fNHistograms; id++)
+        total[id] = empty.Get(id)->ToTH1();
+    for (int batch = 0; batch < N_BATCHES; batch++) {
+        vector<TH1 *> h = generate(batch, N_VALIDATION_EVENTS / N_BATCHES);
+        for (int id = 0; id < Histograms::fNHistograms; id++) {
+            total[id]->Add(h[id]);
+            batches[id].push_back(h[id]);
+        }
+    }
+}
+
+// Optimized generation, as in a run, with its histograms exported to ROOT ones
+static vector<TH1 *> GenerateOptimized(Histograms &optimized, Long64_t firstEvent, int nEvents) {
+    const PairTable pairTable;
+    PhiloxRandom rng(gConfig.seed);
+    Histograms h;
+    GenerateEvents(h, pairTable, &rng, firstEvent, nEvents);
+    optimized.Add(h);
+    vector<TH1 *> exported(Histograms::fNHistograms);
+    for (int id = 0; id < Histograms::fNHistograms; id++)
+        exported[id] = h.Get(id)->ToTH1();
+    return exported;
+}
+
+static void DeleteAll(vector<TH1 *> &total, vector<vector<TH1 *> > &batches) {
+    for (int id = 0; id < Histograms::fNHistograms; id++) {
+        delete total[id];
+        for (TH1 *h : batches[id])
+            delete h;
+    }
+}
+
+// Independent samples of the same distributions: tests must not reject them. Pair histograms
+// are tested at their effective statistics, as their bins are correlated, and so are the
+// weighted ones, whose bins fluctuate more than counts
+static void CompareHistograms(const string label, const vector<TH1 *> &optimized, const vector<vector<TH1 *> > &optimizedBatches,
+                              const vector<TH1 *> &reference, const vector<vector<TH1 *> > &referenceBatches) {
+    for (int id = 0; id < Histograms::fNHistograms; id++) {
+        if (id == Histograms::kMixedPionKaonInvMass)
+            continue;
+        const string name = label + optimized[id]->GetName();
+        for (bool cumulative : {false, true}) {
+            const double overdispersion = max(Overdispersion(optimizedBatches[id], cumulative), Overdispersion(referenceBatches[id], cumulative));
+            TH1 *thinned = Thinned(optimized[id], overdispersion), *thinnedReference = Thinned(reference[id], overdispersion);
+            const double p = cumulative ? thinned->KolmogorovTest(thinnedReference) : thinned->Chi2Test(thinnedReference, "UU");
+            Report(name + (cumulative ? ", Kolmogorov-Smirnov" : ", chi2") + " test p-value at overdispersion " + to_string(overdispersion), p, MIN_P_VALUE, p >= MIN_P_VALUE);
+            delete thinned;
+            delete thinnedReference;
+        }
+    }
+}
+
+// Histograms of the optimized generator, unweighted and with VALIDATION_BIASES, against those
+// of the reference one, and consistency of their numbers of entries, also with a Poisson
+// distributed number of primaries
+static void ValidateHistograms() {
+    gConfig.multiplicity = "fixed";
+    vector<TH1 *> reference, optimized;
+    vector<vector<TH1 *> > referenceBatches, optimizedBatches;
+    TRandom3 referenceRng(gConfig.seed);
+    GenerateBatches(reference, referenceBatches, [&](int, int nEvents) {
+        const Histograms empty;
+        vector<TH1 *> h(Histograms::fNHistograms);
+        for (int id = 0; id < Histograms::fNHistograms; id++)
+            h[id] = empty.Get(id)->ToTH1();
+        GenerateReference(h, nEvents, referenceRng);
+        return h;
+    });
+
+    const map<string, double> biases = gConfig.particleBiases;
+    for (bool weighted : {false, true}) {
+        gConfig.particleBiases = weighted ? VALIDATION_BIASES : map<string, double>();
+        Histograms all;
+        GenerateBatches(optimized, optimizedBatches, [&](int batch, int nEvents) {
+            return GenerateOptimized(all, (Long64_t) batch * nEvents, nEvents);
+        });
+        const string label = weighted ? "weighted " : "";
+        CompareHistograms(label, optimized, optimizedBatches, reference, referenceBatches);
+        const int nFailedChecks = Checks(all, N_VALIDATION_EVENTS);
+        Report(label + "Checks, failed consistency checks", nFailedChecks, 0, nFailedChecks == 0);
+        DeleteAll(optimized, optimizedBatches);
+    }
+    gConfig.particleBiases = biases;
+    DeleteAll(reference, referenceBatches);
+
+    // Numbers of entries with a Poisson distributed number of primaries
+    gConfig.multiplicity = "poisson";
+    Histograms poisson;
+    vector<TH1 *> exported = GenerateOptimized(poisson, 0, N_VALIDATION_EVENTS);
+    const int nFailedChecks = Checks(poisson, N_VALIDATION_EVENTS);
+    Report("poisson multiplicity Checks, failed consistency checks", nFailedChecks, 0, nFailedChecks == 0);
+    for (TH1 *h : exported)
+        delete h;
+}
+
+int main(int argc, char **argv) {
+    vector<string> arguments;
+    if (!gConfig.ParseArguments(argc, argv, arguments))
+        return 1;
+    if (!InitParticleTypes())
+        return 1;
+
+    ValidateKernels();
+    ValidateHistograms();
+    if (gNFailed > 0)
+        std::cout << gNFailed << " comparisons failed" << std::endl;
+    else
+        std::cout << "All comparisons passed" << std::endl;
+    return gNFailed;
+}
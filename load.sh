@@ -1,11 +1,26 @@
 #!/bin/bash
 root -l <<EOF
+.L Config.cpp+
 .L ParticleType.cpp+
 .L ResonanceType.cpp+
+.L PhiloxRandom.cpp+
+.L AliasSampler.cpp+
 .L Particle.cpp+
+.L FixedHistogram.cpp+
+.L Histograms.cpp+
+.L PairTable.cpp+
+.L Profiler.cpp+
+gSystem->SetFlagsOpt("-O3 -march=native -fno-math-errno");
+.L EventBuffer.cpp+O
+.L EventArena.cpp+O
+.L EventMixer.cpp+O
+.L PairAnalysis.cpp+O
+.L EventStore.cpp+O
+.L EventPipeline.cpp+O
 .L GenerateParticles.cpp+
-GenerateParticles();
-.! cp histograms.root histograms_copy.root
 .L AnalyzeData.cpp+
-AnalyzeData();
+.L RebuildHistograms.cpp+
+.L Checks.cpp+
+GenerateAndAnalyze();
+.! cp histograms.root histograms_copy.root
 EOF
@@ -0,0 +1,77 @@
+#include "AnalyzeData.h"
+#include "Config.h"
+#include "GenerateParticles.h"
+#include "RebuildHistograms.h"
+#include "Scan.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void PrintUsage(const char *program) {
+    std::cout << "Usage: " << program << " [command] [--config=file] [--key=value ...]" << std::endl <<
+                 "Commands:" << std::endl <<
+                 "    all           generate and analyze in memory, saving histogramsFile unless empty (default)" << std::endl <<
+                 "    generate      generate nIterations events in histogramsFile" << std::endl <<
+                 "    adaptive      generate until the K* peak is fitted with the target errors" << std::endl <<
+                 "    resume        continue the interrupted run saved in checkpointFile" << std::endl <<
+                 "    extend <n>    add n events to the run saved in histogramsFile" << std::endl <<
+                 "    shard <k> <n> generate shard k of n of the run in histogramsFile_k" << std::endl <<
+                 "    merge <files> merge the complete shards in files in histogramsFile" << std::endl <<
+                 "    rebuild       rebuild histogramsFile from the events saved in eventsFile" << std::endl <<
+                 "    analyze       analyze the histograms in histogramsFile" << std::endl <<
+                 "    scan <file>   generate and summarize the points listed in file, nJobs at a time" << std::endl <<
+                 "    config        print the parameters and exit" << std::endl <<
+                 "Parameters are applied in order, the keys are listed by the config command" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    vector<string> arguments;
+    if (!gConfig.ParseArguments(argc, argv, arguments)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    const string command = arguments.empty() ? "all" : arguments[0];
+    const char *eventsFileName = gConfig.eventsFile.empty() ? 0 : gConfig.eventsFile.c_str();
+    if (command == "all")
+        GenerateAndAnalyze(gConfig.nThreads, gConfig.seed, eventsFileName);
+    else if (command == "generate")
+        GenerateParticles(gConfig.nThreads, gConfig.seed, eventsFileName);
+    else if (command == "adaptive")
+        GenerateAdaptive(gConfig.nThreads, gConfig.seed);
+    else if (command == "resume")
+        ResumeParticles(gConfig.nThreads);
+    else if (command == "extend" && arguments.size() == 2) {
+        long long nEvents;
+        if (!ParseNumber(arguments[1], nEvents) || nEvents < 1) {
+            std::cout << "Invalid number of events " << arguments[1] << ": expected a number of at least 1" << std::endl;
+            return 1;
+        }
+        ExtendParticles(nEvents, gConfig.nThreads);
+    } else if (command == "shard" && arguments.size() == 3) {
+        int shard, nShards;
+        if (!ParseNumber(arguments[2], nShards) || nShards < 1 || !ParseNumber(arguments[1], shard) || shard < 0 || shard >= nShards) {
+            std::cout << "Invalid shard " << arguments[1] << " of " << arguments[2] << ": expected k and n with 0 <= k < n" << std::endl;
+            return 1;
+        }
+        GenerateShard(shard, nShards, gConfig.nThreads, gConfig.seed, eventsFileName);
+    }
+    else if (command == "merge" && arguments.size() > 1)
+        return MergeRuns(vector<string>(arguments.begin() + 1, arguments.end()), gConfig.histogramsFile) ? 0 : 1;
+    else if (command == "rebuild" && eventsFileName)
+        return RebuildHistograms(eventsFileName, gConfig.histogramsFile.c_str(), gConfig.nThreads) ? 0 : 1;
+    else if (command == "analyze")
+        AnalyzeData();
+    else if (command == "scan" && arguments.size() == 2)
+        return RunScan(arguments[1], gConfig.nJobs) ? 0 : 1;
+    else if (command == "config")
+        gConfig.Print();
+    else {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    return 0;
+}